@@ -1,9 +1,28 @@
 #pragma once
+#include "phpext/bindings.hpp"
 #include "phpext/build_traits.hpp"
 #include "phpext/classes.hpp"
+#include "phpext/compact.hpp"
+#include "phpext/constants.hpp"
 #include "phpext/conversions.hpp"
 #include "phpext/extension.hpp"
+#include "phpext/hash.hpp"
+#include "phpext/immutable_array.hpp"
 #include "phpext/ini.hpp"
+#include "phpext/interrupt.hpp"
+#include "phpext/json.hpp"
+#include "phpext/lru_cache.hpp"
+#include "phpext/memoize.hpp"
+#include "phpext/overloads.hpp"
+#include "phpext/persistent.hpp"
+#include "phpext/policies.hpp"
+#include "phpext/refs.hpp"
+#include "phpext/request_table.hpp"
+#include "phpext/shm.hpp"
+#include "phpext/snapshot.hpp"
+#include "phpext/string_pool.hpp"
 #include "phpext/strings.hpp"
+#include "phpext/vectorized.hpp"
+#include "phpext/worker_pool.hpp"
 #include "phpext/zmm.hpp"
 
@@ -0,0 +1,172 @@
+#pragma once
+#include <php.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <Zend/zend_exceptions.h>
+#include "classes.hpp"
+#include "conversions.hpp"
+#include "interrupt.hpp"
+#include "strings.hpp"
+#include "worker_pool.hpp"
+
+namespace zend {
+
+namespace async_detail {
+// shared between the request thread and one worker. The worker publishes
+// completion with a release store on done; the request thread only looks at
+// the result after an acquire load, so no lock is taken on the fast path
+struct task_base {
+    std::atomic<bool> done{false};
+    std::exception_ptr error;
+    std::mutex mutex; // only for blocking waits
+    std::condition_variable cv;
+
+    virtual ~task_base() = default;
+    virtual void run() noexcept = 0;
+    // request thread only
+    virtual zval materialize() = 0;
+
+    bool is_done() const noexcept {
+        return done.load(std::memory_order_acquire);
+    }
+
+    void wait() {
+        if (is_done()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock{mutex};
+        cv.wait(lock, [this]() { return is_done(); });
+    }
+
+    bool wait_for(std::chrono::milliseconds timeout) {
+        if (is_done()) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock{mutex};
+        return cv.wait_for(lock, timeout, [this]() { return is_done(); });
+    }
+
+protected:
+    void complete() noexcept {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            done.store(true, std::memory_order_release);
+        }
+        cv.notify_all();
+    }
+};
+
+template<typename F>
+struct task : task_base {
+    using result_type = std::invoke_result_t<F &>;
+    static_assert(!std::is_void_v<result_type>, "tasks must return a value");
+    static_assert(!std::is_reference_v<result_type>,
+                  "tasks must return by value");
+
+    F func;
+    std::optional<result_type> result;
+
+    template<typename U>
+    explicit task(U &&func) : func{std::forward<U>(func)} {}
+
+    void run() noexcept override {
+        try {
+            result.emplace(func());
+        } catch (...) {
+            error = std::current_exception();
+        }
+        complete();
+    }
+
+    zval materialize() override {
+        zval zv = convert_to_zval(std::move(*result));
+        result.reset();
+        return zv;
+    }
+};
+} // namespace async_detail
+
+/* Handle to native work running on the worker_pool. The result is converted
+ * into a zval on the request thread, the first time it is asked for */
+class Future : public PHPClass<Future> {
+public:
+    static constexpr auto php_class_name = "Phpext\\Future"_cs;
+
+    // f runs on a worker thread. Its result is converted with
+    // convert_to_zval, so it should be a plain C++ value
+    template<typename F>
+    static Future submit(F &&f) {
+        using task_t = async_detail::task<std::decay_t<F>>;
+        auto t = std::make_shared<task_t>(std::forward<F>(f));
+        worker_pool::instance().submit([t]() { t->run(); });
+        return Future{std::move(t)};
+    }
+
+    Future(const Future &oth) : PHPClass<Future>{oth}, task{oth.task} {
+        ZVAL_COPY(&result_zv, &oth.result_zv);
+    }
+    Future(Future &&oth) : PHPClass<Future>{}, task{std::move(oth.task)} {
+        ZVAL_COPY_VALUE(&result_zv, &oth.result_zv);
+        ZVAL_UNDEF(&oth.result_zv);
+    }
+    ~Future() {
+        zval_ptr_dtor(&result_zv);
+    }
+
+    static void register_php_methods() {
+        reg_instance_method<&Future::isReady>("isReady");
+        reg_instance_method<&Future::wait>("wait");
+        reg_instance_method<&Future::result>("result");
+    }
+
+private:
+    explicit Future(std::shared_ptr<async_detail::task_base> task)
+        : task{std::move(task)} {
+        ZVAL_UNDEF(&result_zv);
+    }
+
+    bool isReady() {
+        return task->is_done();
+    }
+
+    void wait() {
+        // wake up now and then so time limits and signals are honoured
+        while (!task->wait_for(std::chrono::milliseconds{10})) {
+            check_interrupt();
+        }
+    }
+
+    zval_mixed result() {
+        wait();
+        if (task->error) {
+            try {
+                std::rethrow_exception(task->error);
+            } catch (const std::exception &e) {
+                zend_throw_exception_ex(zend_ce_exception, 0,
+                                        "Native task failed: %s", e.what());
+            } catch (...) {
+                zend_throw_exception_ex(zend_ce_exception, 0,
+                                        "Native task failed");
+            }
+            zval null_zv;
+            ZVAL_NULL(&null_zv);
+            return zval_mixed{null_zv};
+        }
+        if (Z_ISUNDEF(result_zv)) {
+            result_zv = task->materialize();
+        }
+        zval_mixed ret{result_zv};
+        ret.add_ref();
+        return ret;
+    }
+
+    std::shared_ptr<async_detail::task_base> task;
+    zval result_zv;
+};
+}
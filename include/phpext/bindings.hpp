@@ -0,0 +1,108 @@
+#pragma once
+#include <php.h>
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "conversions.hpp"
+#include "policies.hpp"
+
+namespace zend {
+
+/* Declarative alternative to calling reg_function()/reg_instance_method()/
+ * reg_static_method() from register_php_methods(). The bindings are listed
+ * in a constexpr tuple, and the function table is a static array built from
+ * it once, when the module entry is first requested; no vector is grown
+ * and nothing is allocated in MINIT:
+ *
+ *    class MyExt : public PHPExtension<MyExt> {
+ *    public:
+ *        static constexpr auto function_defs = std::tuple{
+ *                def_function<&f>("f"),
+ *                def_function<&g>("g", zend::memoize)};
+ *    };
+ *
+ *    class Point : public PHPClass<Point> {
+ *    public:
+ *        static constexpr auto method_defs = std::tuple{
+ *                def_method<&Point::norm>("norm"),
+ *                def_method<&Point::origin>("origin")}; // static
+ *    };
+ *
+ * Both forms can be used together; the registered entries follow the
+ * declared ones */
+template<auto func, typename A, typename... Policies>
+struct function_def {
+    static_assert(are_policies<Policies...>);
+    const char *name;
+};
+
+template<auto func, typename A = arg_names_empty_t, typename... Policies>
+constexpr function_def<func, A, Policies...> def_function(const char *name,
+                                                          Policies...) {
+    return {name};
+}
+
+// method flags; also available as PHPClass<C>::AccFlags
+enum class AccFlags : decltype(zend_function_entry::flags) {
+    PUBLIC    = ZEND_ACC_PUBLIC,
+    PROTECTED = ZEND_ACC_PROTECTED,
+    PRIVATE   = ZEND_ACC_PRIVATE,
+    // STATIC    = ZEND_ACC_STATIC, (dedicated method)
+    FINAL     = ZEND_ACC_FINAL,
+    // ABSTRACT  = ZEND_ACC_ABSTRACT, (dedicated method)
+};
+
+// static methods get ZEND_ACC_STATIC added
+template<auto func, typename A, typename... Policies>
+struct method_def {
+    static_assert(are_policies<Policies...>);
+    const char *name;
+    AccFlags flags;
+};
+
+template<auto func, typename A = arg_names_empty_t, typename... Policies>
+constexpr method_def<func, A, Policies...> def_method(const char *name,
+                                                      Policies...) {
+    return {name, AccFlags::PUBLIC};
+}
+
+template<auto func, typename A = arg_names_empty_t, typename... Policies>
+constexpr method_def<func, A, Policies...> def_method(const char *name,
+                                                      AccFlags flags,
+                                                      Policies...) {
+    return {name, flags};
+}
+
+namespace bindings_detail {
+// the entries for the defs in the tuple, plus the terminator; make_entry
+// builds the entry for one def
+template<typename Defs, typename F>
+auto make_table(const Defs &defs, F make_entry) {
+    return std::apply(
+            [&](const auto &... def) {
+                return std::array<zend_function_entry,
+                                  std::tuple_size_v<Defs> + 1>{
+                        make_entry(def)..., zend_function_entry{}};
+            },
+            defs);
+}
+
+/* the declared entries followed by the registered ones, if any (in which
+ * case they're all copied into the vector) */
+template<size_t N>
+const zend_function_entry *
+merge_table(const std::array<zend_function_entry, N> &declared,
+            std::vector<zend_function_entry> &registered) {
+    if (registered.empty()) {
+        return declared.data();
+    }
+    registered.insert(registered.begin(), declared.begin(),
+                      declared.end() - 1);
+    registered.emplace_back();
+    return registered.data();
+}
+} // namespace bindings_detail
+}
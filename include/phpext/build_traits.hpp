@@ -9,4 +9,11 @@ using zts_build = std::true_type;
 #else
 using zts_build = std::false_type;
 #endif
+
+// bindings not marked hot use the compact trampolines; see compact.hpp
+#ifdef PHPEXT_COMPACT_BINDINGS
+using compact_bindings = std::true_type;
+#else
+using compact_bindings = std::false_type;
+#endif
 }
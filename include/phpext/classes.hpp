@@ -2,12 +2,20 @@
 
 #include <php.h>
 #include <array>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <type_traits>
 #include <vector>
 #include <Zend/zend_exceptions.h>
+#include "bindings.hpp"
+#include "build_traits.hpp"
+#include "compact.hpp"
+#include "constants.hpp"
 #include "conversions.hpp"
+#include "memoize.hpp"
+#include "overloads.hpp"
+#include "policies.hpp"
 
 namespace zend {
 
@@ -113,16 +121,15 @@ private:
 
     template<typename FT, typename FT::func_type func>
     static zif_handler wrap_method() {
-        zif_handler wrapped = [](INTERNAL_FUNCTION_PARAMETERS) -> void {
+        static constexpr zif_handler body = [](INTERNAL_FUNCTION_PARAMETERS) {
             using arg_traits = typename FT::arg_traits;
-            constexpr auto max_params = arg_traits::max_args;
-            constexpr auto min_params = arg_traits::min_args;
             constexpr auto is_inst_meth = FT::is_member_func::value;
             constexpr bool is_ctor = FT::is_ctor::value;
 
             auto given_args = ZEND_NUM_ARGS();
-            if (given_args > max_params || given_args < min_params) {
-                zend_wrong_parameters_count_exception(min_params, max_params);
+            if (!arg_traits::accepts(given_args)) {
+                zend_wrong_parameters_count_exception(arg_traits::min_args,
+                                                      arg_traits::max_params);
                 return;
             }
 
@@ -151,12 +158,9 @@ private:
                 }
             }
 
-            std::array<zval, max_params> args_zv;
-            zend_get_parameters_array_ex(static_cast<int>(given_args),
-                                         args_zv.data());
-            // must last until after the call
-            auto opt_tuple = convert_from_zval<
-                    typename arg_traits::types>(given_args, args_zv.data());
+            // converted in the call frame; must last until after the call
+            auto opt_tuple = convert_from_zval<typename arg_traits::types>(
+                    given_args, ZEND_CALL_ARG(execute_data, 1));
             if (!opt_tuple.has_value()) {
                 return;
             }
@@ -173,22 +177,29 @@ private:
                 }
             };
 
-            if constexpr (is_ctor || FT::is_void::value) {
-                call_tuple(f_this, tuple_conv_args);
-                if constexpr (is_ctor) {
-                    c->state = state::VALID;
-                    // restore. The constructor call resets it to null
-                    c->zobj_self = &zobj->parent; 
+            try {
+                if constexpr (is_ctor || FT::is_void::value) {
+                    call_tuple(f_this, tuple_conv_args);
+                    if constexpr (is_ctor) {
+                        c->state = state::VALID;
+                        // restore. The constructor call resets it to null
+                        c->zobj_self = &zobj->parent;
+                    }
+                } else {
+                    decltype(auto) res = call_tuple(f_this, tuple_conv_args);
+                    static_assert(std::is_same_v<typename FT::ret_type,
+                                                 decltype(res)>);
+                    *return_value =
+                            convert_to_zval(std::forward<decltype(res)>(res));
                 }
-            } else {
-                decltype(auto) res = call_tuple(f_this, tuple_conv_args);
-                static_assert(
-                        std::is_same_v<typename FT::ret_type, decltype(res)>);
-                *return_value =
-                        convert_to_zval(std::forward<decltype(res)>(res));
+            } catch (const zval_conversions::error_from &err) {
+                // from a variadic argument, converted during the call
+                zval_conversions::handle_error(err);
             }
         };
-        return wrapped;
+        return [](INTERNAL_FUNCTION_PARAMETERS) -> void {
+            interruptible(body, INTERNAL_FUNCTION_PARAM_PASSTHRU);
+        };
     }
 
     template<typename FT>
@@ -198,23 +209,67 @@ private:
 
     static inline zend_object_handlers handlers;
     static inline std::vector<zend_function_entry> functions;
+    static inline std::vector<constant_def> constants;
 protected:
-    enum class AccFlags : decltype(zend_function_entry::flags) {
-        PUBLIC    = ZEND_ACC_PUBLIC,
-        PROTECTED = ZEND_ACC_PROTECTED,
-        PRIVATE   = ZEND_ACC_PRIVATE,
-        // STATIC    = ZEND_ACC_STATIC, (dedicated method)
-        FINAL     = ZEND_ACC_FINAL,
-        // ABSTRACT  = ZEND_ACC_ABSTRACT, (dedicated method)
-    };
+    using AccFlags = zend::AccFlags;
 
-    template<typename FT, typename FT::func_type func>
+    template<typename FT, typename FT::func_type func, typename... Policies>
     static void reg_method_ex(const char *name, AccFlags flags) {
-        auto wrapped_func = wrap_method<FT, func>();
+        functions.push_back(method_entry_ex<FT, func, Policies...>(
+                name,
+                static_cast<decltype(zend_function_entry::flags)>(flags)));
+    }
+
+    template<typename FT, typename FT::func_type func, typename... Policies>
+    static zend_function_entry method_entry_ex(const char *name,
+                                               uint32_t flags) {
+        // the cache key doesn't include $this
+        static_assert(!FT::is_member_func::value ||
+                              !has_policy<memoize_t, Policies...>,
+                      "instance methods can't be memoized");
+        constexpr auto make = [] {
+            if constexpr (use_compact<FT, Policies...>()) {
+                return &wrap_compact_function<FT, func>;
+            } else {
+                return &wrap_method<FT, func>;
+            }
+        }();
+        auto wrapped_func = make();
+        if constexpr (has_policy<memoize_t, Policies...>) {
+            wrapped_func = wrap_memoized<make>();
+        }
         const auto arginfo = php_arg_info_holder<FT>::as_ziai_array();
-        functions.push_back({
-                name, wrapped_func, arginfo, FT::arg_traits::max_args,
-                static_cast<decltype(zend_function_entry::flags)>(flags)});
+        return {name, wrapped_func, arginfo, FT::arg_traits::max_args, flags};
+    }
+
+    template<auto func, typename A, typename... Policies>
+    static zend_function_entry
+    method_entry(const method_def<func, A, Policies...> &def) {
+        using FT = cpp_func_traits<decltype(func), A>;
+        auto flags = static_cast<uint32_t>(def.flags);
+        if constexpr (!FT::is_member_func::value) {
+            flags |= ZEND_ACC_STATIC;
+        }
+        return method_entry_ex<FT, func, Policies...>(def.name, flags);
+    }
+
+    template<typename T = C, typename = void>
+    struct has_method_defs : std::false_type {};
+    template<typename T>
+    struct has_method_defs<T, decltype((void)T::method_defs)>
+        : std::true_type {};
+
+    static const zend_function_entry *method_table() {
+        if constexpr (has_method_defs<>::value) {
+            static const auto declared = bindings_detail::make_table(
+                    C::method_defs, [](const auto &def) {
+                        return method_entry(def);
+                    });
+            return bindings_detail::merge_table(declared, functions);
+        } else {
+            functions.emplace_back();
+            return functions.data();
+        }
     }
 
     template<typename... Args>
@@ -241,20 +296,107 @@ protected:
         reg_method_ex<func_traits, func>(name, flags);
     }
 
-    template<auto func, typename A = arg_names_empty_t>
-    static void reg_static_method(const char *name,
-                                  AccFlags flags = AccFlags::PUBLIC) {
+    template<auto func, typename A = arg_names_empty_t, typename... Policies>
+    static void reg_static_method(const char *name, AccFlags flags,
+                                  Policies...) {
+        static_assert(are_policies<Policies...>);
         using func_traits = cpp_func_traits<decltype(func), A>;
         static_assert(!func_traits::is_member_func::value);
         flags = static_cast<AccFlags>(
                 static_cast<std::underlying_type_t<AccFlags>>(flags) |
                 ZEND_ACC_STATIC);
-        reg_method_ex<func_traits, func>(name, flags);
+        reg_method_ex<func_traits, func, Policies...>(name, flags);
+    }
+
+    template<auto func, typename A = arg_names_empty_t, typename... Policies>
+    static void reg_static_method(const char *name, Policies... policies) {
+        reg_static_method<func, A>(name, AccFlags::PUBLIC, policies...);
+    }
+
+    // all instance or all static methods, tried in order; see overloads.hpp
+    template<auto... funcs>
+    static void reg_overloads(const char *name,
+                              AccFlags flags = AccFlags::PUBLIC) {
+        using set = overload_detail::overload_set<
+                cpp_func_traits<decltype(funcs)>...>;
+        constexpr bool any_static =
+                (!cpp_func_traits<decltype(funcs)>::is_member_func::value ||
+                 ...);
+        static_assert(
+                ((cpp_func_traits<decltype(funcs)>::is_member_func::value ==
+                  !any_static) &&
+                 ...),
+                "cannot mix instance and static methods");
+        static const zif_handler handlers[] = {
+                wrap_method<cpp_func_traits<decltype(funcs)>, funcs>()...};
+        auto acc = static_cast<decltype(zend_function_entry::flags)>(flags);
+        if constexpr (any_static) {
+            acc |= ZEND_ACC_STATIC;
+        }
+        functions.push_back({
+                name,
+                [](INTERNAL_FUNCTION_PARAMETERS) -> void {
+                    set::dispatch(handlers, INTERNAL_FUNCTION_PARAM_PASSTHRU);
+                },
+                set::arginfo(), set::max_args, acc});
+    }
+
+    // declared once the class is registered
+    static void reg_class_constant(const char *name, constant_value value) {
+        constants.push_back({name, value});
     }
 
     static void register_php_methods() {}
-public:
-    static void register_class() noexcept {
+private:
+    /* lazy registration: the class entry has no methods until the first
+     * method lookup, which registers them and restores the std handlers */
+    static inline const zend_function_entry *pending_methods;
+    static inline zend_module_entry *registering_module;
+
+    static void register_pending_methods() {
+        const zend_function_entry *methods = pending_methods;
+        pending_methods = nullptr;
+        handlers.get_method = zend_std_get_method;
+        handlers.get_constructor = zend_std_get_constructor;
+        ce->get_static_method = nullptr;
+
+        // as if in MINIT: the functions belong to the module
+        zend_module_entry *cur_module = EG(current_module);
+        EG(current_module) = registering_module;
+        zend_register_functions(ce, methods, &ce->function_table,
+                                MODULE_PERSISTENT);
+        EG(current_module) = cur_module;
+    }
+
+    static zend_function *lazy_get_method(zend_object **zobj,
+                                          zend_string *method,
+                                          const zval *key) {
+        register_pending_methods();
+        return zend_std_get_method(zobj, method, key);
+    }
+
+    static zend_function *lazy_get_constructor(zend_object *zobj) {
+        register_pending_methods();
+        return zend_std_get_constructor(zobj);
+    }
+
+    static zend_function *lazy_get_static_method(zend_class_entry *ce,
+                                                 zend_string *method) {
+        register_pending_methods();
+        return zend_std_get_static_method(ce, method, nullptr);
+    }
+
+    /* after startup, zend_register_functions() can only find the names in
+     * the permanent interned strings; it would create request-bound ones */
+    static void intern_method_names(const zend_function_entry *methods) {
+        for (; methods->fname; methods++) {
+            zend_string *name = zend_string_init_interned(
+                    methods->fname, strlen(methods->fname), 1);
+            zend_new_interned_string(zend_string_tolower_ex(name, 1));
+        }
+    }
+
+    static void register_class(bool lazy) noexcept {
         handlers = *zend_get_std_object_handlers();
         handlers.free_obj = free_object_handler;
         handlers.clone_obj = nullptr; // TODO
@@ -263,15 +405,47 @@ public:
         {
           zend_class_entry temp_ce;
           C::register_php_methods();
-          functions.emplace_back();
-          auto& cname = C::php_class_name;
-          INIT_CLASS_ENTRY_EX(temp_ce, cname, cname.length(),
-                              functions.data())
+          const zend_function_entry *methods = method_table();
+          if (lazy) {
+              intern_method_names(methods);
+              pending_methods = methods;
+              registering_module = EG(current_module);
+          }
+          // already interned: this finds it instead of creating a string
+          zend_string *cname = zs(C::php_class_name);
+          INIT_CLASS_ENTRY_EX(temp_ce, ZSTR_VAL(cname), ZSTR_LEN(cname),
+                              lazy ? nullptr : methods)
           ce = zend_register_internal_class(&temp_ce);
         }
+        for (const constant_def &def : constants) {
+            declare_class_constant(ce, def);
+        }
         ce->ce_flags |= ZEND_ACC_FINAL;
         ce->clone = nullptr;
         ce->create_object = ce_create_object;
+        if (lazy) {
+            handlers.get_method = lazy_get_method;
+            handlers.get_constructor = lazy_get_constructor;
+            ce->get_static_method = lazy_get_static_method;
+        }
+    }
+
+public:
+    static void register_class() noexcept {
+        register_class(false);
+    }
+
+    /* Like register_class(), but the methods are only added to the class
+     * entry when first looked up (a call, a callable check, new), so the
+     * classes a request never uses cost only their class entry. Until then,
+     * reflection, method_exists() and get_class_methods() see no methods,
+     * so don't use it for classes that may be inspected before use (DI
+     * containers, mocking libraries).
+     *
+     * In ZTS builds the class entries are shared by the threads and can't
+     * be changed after startup, so this registers the class eagerly */
+    static void register_class_lazily() noexcept {
+        register_class(!zts_build::value);
     }
 
     friend zval_o<C> zval_conversions::to_zval(const PHPClass<C> &);
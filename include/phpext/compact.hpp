@@ -0,0 +1,263 @@
+#pragma once
+#include <php.h>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "build_traits.hpp"
+#include "conversions.hpp"
+#include "interrupt.hpp"
+#include "policies.hpp"
+
+namespace zend {
+
+/* Compact bindings: instead of a handler with the whole conversion, error
+ * handling and call sequence specialized for each binding, they share one
+ * trampoline driven by a descriptor of the parameters, generated at compile
+ * time. What is left per binding is a stub passing the descriptor and a
+ * thunk calling the function with the converted values.
+ *
+ * A binding is compact with the zend::compact policy or, when built with
+ * PHPEXT_COMPACT_BINDINGS, unless it has the zend::hot policy. Only free
+ * functions and static methods whose parameters are integers, doubles,
+ * booleans, zstring_view or zval_mixed (possibly std::optional) can be;
+ * with PHPEXT_COMPACT_BINDINGS the others keep a specialized handler.
+ *
+ * The conversions and error messages are the same as for specialized
+ * bindings */
+namespace compact_detail {
+constexpr size_t max_compact_args = 8;
+
+enum kind : uint8_t {
+    unsupported,
+    long_kind,
+    int_kind, // range checked
+    double_kind,
+    bool_kind,
+    string_kind,
+    mixed_kind,
+};
+constexpr uint8_t nullable = 0x80;
+
+template<typename T>
+constexpr uint8_t kind_of() {
+    using opt = is_optional<std::remove_cv_t<T>>;
+    using B = std::remove_cv_t<typename opt::base_type>;
+    constexpr uint8_t flags = opt::value ? nullable : 0;
+    if constexpr (std::is_reference_v<T>) {
+        return unsupported;
+    } else if constexpr (std::is_same_v<B, bool>) {
+        return bool_kind | flags;
+    } else if constexpr (std::is_same_v<B, zend_long>) {
+        return long_kind | flags;
+    } else if constexpr (std::is_same_v<B, int>) {
+        return int_kind | flags;
+    } else if constexpr (std::is_same_v<B, double>) {
+        return double_kind | flags;
+    } else if constexpr (std::is_same_v<B, zstring_view>) {
+        return string_kind | flags;
+    } else if constexpr (std::is_same_v<B, zval_mixed> && !opt::value) {
+        return mixed_kind;
+    } else {
+        return unsupported;
+    }
+}
+
+// a converted argument; which member depends on the kind
+struct arg_value {
+    union {
+        zend_long l;
+        double d;
+        bool b;
+        zend_string *s;
+        zval *zv;
+    };
+    bool present; // false for null passed to (or omitted for) an optional
+};
+
+struct descriptor {
+    void (*invoke)(const arg_value *args, zval *return_value);
+    uint8_t min_args;
+    uint8_t max_args;
+    uint8_t kinds[max_compact_args];
+};
+
+template<typename T>
+T native_value(const arg_value &arg) {
+    using opt = is_optional<std::remove_cv_t<T>>;
+    using B = std::remove_cv_t<typename opt::base_type>;
+    if constexpr (opt::value) {
+        if (!arg.present) {
+            return std::nullopt;
+        }
+        return native_value<B>(arg);
+    } else if constexpr (std::is_same_v<B, bool>) {
+        return arg.b;
+    } else if constexpr (std::is_integral_v<B>) {
+        return static_cast<B>(arg.l);
+    } else if constexpr (std::is_same_v<B, double>) {
+        return arg.d;
+    } else if constexpr (std::is_same_v<B, zstring_view>) {
+        return zstring_view{arg.s};
+    } else {
+        return zval_mixed{*arg.zv};
+    }
+}
+
+// the only part specialized for each binding
+template<typename FT, typename FT::func_type func, size_t... Is>
+void invoke(const arg_value *args, zval *return_value) {
+    using types = typename FT::arg_traits::types;
+    if constexpr (FT::is_void::value) {
+        func(native_value<std::tuple_element_t<Is, types>>(args[Is])...);
+    } else {
+        decltype(auto) res =
+                func(native_value<std::tuple_element_t<Is, types>>(args[Is])...);
+        *return_value = convert_to_zval(std::forward<decltype(res)>(res));
+    }
+}
+
+template<typename FT, typename FT::func_type func, size_t... Is>
+constexpr descriptor make_descriptor(std::index_sequence<Is...>) {
+    using arg_traits = typename FT::arg_traits;
+    return {&invoke<FT, func, Is...>,
+            static_cast<uint8_t>(arg_traits::min_args),
+            static_cast<uint8_t>(arg_traits::max_args),
+            {kind_of<typename arg_traits::template elem_type<Is>>()...}};
+}
+
+template<typename FT, typename FT::func_type func>
+inline constexpr descriptor descriptor_for = make_descriptor<FT, func>(
+        std::make_index_sequence<FT::arg_traits::max_args>{});
+
+template<typename FT, size_t... Is>
+constexpr bool supported(std::index_sequence<Is...>) {
+    return ((kind_of<typename FT::arg_traits::template elem_type<Is>>() !=
+             unsupported) &&
+            ... && true);
+}
+
+template<typename FT>
+constexpr bool eligible = [] {
+    using arg_traits = typename FT::arg_traits;
+    if constexpr (FT::is_member_func::value || FT::is_ctor::value ||
+                  arg_traits::has_variadic ||
+                  arg_traits::max_args > max_compact_args) {
+        return false;
+    } else {
+        return supported<FT>(
+                std::make_index_sequence<arg_traits::max_args>{});
+    }
+}();
+
+inline bool convert_args(const descriptor &desc, uint32_t num_args,
+                         zval *args, arg_value *out) {
+    for (uint32_t i = 0; i < desc.max_args; i++) {
+        const uint8_t kind = desc.kinds[i];
+        zval *zv = i < num_args ? &args[i] : nullptr;
+        if (zv) {
+            ZVAL_DEREF(zv);
+        }
+        if (!zv || Z_TYPE_P(zv) == IS_NULL) {
+            if (kind & nullable) {
+                out[i].present = false;
+                continue;
+            }
+        }
+        out[i].present = true;
+
+        zend_bool is_null = 0;
+        bool success = true;
+        zend_expected_type expected;
+        switch (kind & ~nullable) {
+        case long_kind:
+        case int_kind:
+            expected = Z_EXPECTED_LONG;
+            success = zend_parse_arg_long(zv, &out[i].l, &is_null, 1, 0);
+            if (success && !is_null && (kind & ~nullable) == int_kind &&
+                (out[i].l > std::numeric_limits<int>::max() ||
+                 out[i].l < std::numeric_limits<int>::min())) {
+                zval_conversions::handle_error(
+                        {{ZPP_ERROR_OVERFLOW, expected, nullptr}, i + 1, zv});
+                return false;
+            }
+            break;
+        case double_kind:
+            expected = Z_EXPECTED_DOUBLE;
+            success = zend_parse_arg_double(zv, &out[i].d, &is_null, 1);
+            break;
+        case bool_kind: {
+            expected = Z_EXPECTED_BOOL;
+            zend_bool b;
+            success = zend_parse_arg_bool(zv, &b, &is_null, 1);
+            out[i].b = b;
+            break;
+        }
+        case string_kind: // not coerced, as for zstring_view
+            expected = Z_EXPECTED_STRING;
+            success = Z_TYPE_P(zv) == IS_STRING;
+            if (success) {
+                out[i].s = Z_STR_P(zv);
+            }
+            break;
+        default: // mixed_kind
+            out[i].zv = zv;
+            continue;
+        }
+        if (!success || is_null) {
+            zval_conversions::handle_error(
+                    {{ZPP_ERROR_WRONG_ARG, expected, nullptr}, i + 1, zv});
+            return false;
+        }
+    }
+    return true;
+}
+
+// shared by all the compact bindings; kept out of line in the stubs
+[[gnu::noinline]] inline void call(const descriptor &desc,
+                                   INTERNAL_FUNCTION_PARAMETERS) {
+    uint32_t given_args = ZEND_NUM_ARGS();
+    if (given_args < desc.min_args || given_args > desc.max_args) {
+        zend_wrong_parameters_count_exception(desc.min_args, desc.max_args);
+        return;
+    }
+    arg_value args[max_compact_args];
+    if (!convert_args(desc, given_args, ZEND_CALL_ARG(execute_data, 1),
+                      args)) {
+        return;
+    }
+    try {
+        desc.invoke(args, return_value);
+        return;
+    } catch (const interrupted &) {
+    }
+    interrupt_detail::handle_interrupt(execute_data);
+}
+} // namespace compact_detail
+
+template<typename FT, typename... Policies>
+constexpr bool use_compact() {
+    if constexpr (has_policy<compact_t, Policies...>) {
+        static_assert(!has_policy<hot_t, Policies...>,
+                      "a binding can't be both compact and hot");
+        static_assert(compact_detail::eligible<FT>,
+                      "compact bindings are free functions or static methods "
+                      "taking integers, doubles, booleans, zstring_view or "
+                      "zval_mixed");
+        return true;
+    } else if constexpr (has_policy<hot_t, Policies...>) {
+        return false;
+    } else {
+        return compact_bindings::value && compact_detail::eligible<FT>;
+    }
+}
+
+template<typename FT, typename FT::func_type func>
+inline zif_handler wrap_compact_function() {
+    return [](INTERNAL_FUNCTION_PARAMETERS) -> void {
+        compact_detail::call(compact_detail::descriptor_for<FT, func>,
+                             INTERNAL_FUNCTION_PARAM_PASSTHRU);
+    };
+}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <php.h>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include "strings.hpp"
+
+namespace zend {
+
+/* Value of a module or class constant: an integer, a boolean, a double or a
+ * ct_string. The constants are registered at startup as persistent values
+ * (strings interned), so opcache can substitute them at compile time:
+ *
+ *    reg_constant("MYEXT_MAX_DEPTH", 64);
+ *    reg_constant("MYEXT_VERSION", "1.2.0"_cs);
+ */
+class constant_value {
+public:
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    constexpr constant_value(T value) noexcept
+        : type{static_cast<uint8_t>(std::is_same_v<T, bool>
+                                            ? (value ? IS_TRUE : IS_FALSE)
+                                            : IS_LONG)},
+          lval{static_cast<zend_long>(value)} {}
+
+    constexpr constant_value(double value) noexcept
+        : type{IS_DOUBLE}, dval{value} {}
+
+    template<char... Cs>
+    constexpr constant_value(ct_string<char, Cs...> value) noexcept
+        : type{IS_STRING}, str{value, sizeof...(Cs)} {}
+
+    // only during startup, when strings can be interned
+    zval make() const {
+        zval zv;
+        switch (type) {
+        case IS_LONG:
+            ZVAL_LONG(&zv, lval);
+            break;
+        case IS_DOUBLE:
+            ZVAL_DOUBLE(&zv, dval);
+            break;
+        case IS_STRING:
+            ZVAL_INTERNED_STR(&zv, zend_string_init_interned(
+                                           str.data(), str.size(), 1));
+            break;
+        default:
+            Z_TYPE_INFO(zv) = type;
+        }
+        return zv;
+    }
+
+private:
+    uint8_t type;
+    zend_long lval = 0;
+    double dval = 0;
+    std::string_view str;
+};
+
+struct constant_def {
+    const char *name;
+    constant_value value;
+};
+
+inline void register_module_constant(const constant_def &def,
+                                     int module_number) {
+    zend_constant c;
+    c.value = def.value.make();
+    ZEND_CONSTANT_SET_FLAGS(&c, CONST_CS | CONST_PERSISTENT, module_number);
+    c.name = zend_string_init_interned(def.name, strlen(def.name), 1);
+    zend_register_constant(&c);
+}
+
+inline void declare_class_constant(zend_class_entry *ce,
+                                   const constant_def &def) {
+    zval value = def.value.make();
+    zend_declare_class_constant(ce, def.name, strlen(def.name), &value);
+}
+}
@@ -2,10 +2,13 @@
 
 #include <type_traits>
 #include <optional>
+#include <string>
 #include <tuple>
 #include <functional>
 #include <php.h>
 #include <utility>
+#include "hash.hpp"
+#include "interrupt.hpp"
 #include "zmm.hpp"
 #include "strings.hpp"
 
@@ -31,6 +34,30 @@ template<typename T>
 struct is_ref_type<std::reference_wrapper<T>> : std::true_type {
 };
 
+// by-reference parameters modified in place; see refs.hpp
+class string_ref;
+class array_ref;
+template<>
+struct is_ref_type<string_ref> : std::true_type {};
+template<>
+struct is_ref_type<array_ref> : std::true_type {};
+template<typename T>
+constexpr bool is_in_place_ref_v =
+        std::is_same_v<T, string_ref> || std::is_same_v<T, array_ref>;
+
+template<typename T>
+class variadic;
+template<typename T>
+struct is_variadic : std::false_type {
+    using elem_type = T;
+};
+template<typename T>
+struct is_variadic<variadic<T>> : std::true_type {
+    using elem_type = T;
+};
+template<typename T>
+constexpr auto is_variadic_v = is_variadic<T>::value;
+
 template<typename T /* tuple */>
 struct cpp_args_traits {
     using types = T;
@@ -51,15 +78,29 @@ struct cpp_args_traits {
     template<size_t i>
     static constexpr bool is_elem_ref_v = is_elem_ref<i>::value;
 
+    template<size_t i>
+    static constexpr bool is_elem_variadic_v =
+            is_variadic_v<std::remove_cv_t<std::tuple_element_t<i, T>>>;
+
     static constexpr auto max_args = std::tuple_size_v<T>;
 
+    // a trailing variadic<T> takes any number of extra arguments
+    static constexpr bool has_variadic = [] {
+        if constexpr (max_args > 0) {
+            return is_elem_variadic_v<max_args - 1>;
+        } else {
+            return false;
+        }
+    }();
+
     template<size_t pos = max_args>
     constexpr static size_t num_trailing_opts() {
         // pos is 1-based (to avoid underflow if the initial tuple has size 0)
         if constexpr (pos <= 0) {
             return 0;
         } else {
-            if constexpr (is_elem_optional_v<pos - 1>) {
+            if constexpr (is_elem_optional_v<pos - 1> ||
+                          is_elem_variadic_v<pos - 1>) {
                 return 1 + num_trailing_opts<pos - 1>();
             } else {
                 return 0;
@@ -68,6 +109,14 @@ struct cpp_args_traits {
     }
     static constexpr auto optional_args = num_trailing_opts();
     static constexpr auto min_args = max_args - optional_args;
+
+    static constexpr bool accepts(size_t given_args) {
+        return given_args >= min_args &&
+               (has_variadic || given_args <= max_args);
+    }
+    // for zend_wrong_parameters_count_exception: -1 for no maximum
+    static constexpr int max_params =
+            has_variadic ? -1 : static_cast<int>(max_args);
 };
 
 template<const char * ... Names>
@@ -106,6 +155,11 @@ struct cpp_func_traits<void (*)(Args...), ArgNames> : cpp_func_free<ArgNames, Ar
     using is_void = std::true_type;
     using ret_type = void;
 };
+template<typename ArgNames, typename R, typename... Args>
+struct cpp_func_traits<R (*)(Args...) noexcept, ArgNames>
+    : cpp_func_traits<R (*)(Args...), ArgNames> {
+    using func_type = R (*)(Args...) noexcept;
+};
 
 template<typename ArgNames, typename ... Args>
 struct cpp_func_memb : cpp_func_arg_names<ArgNames> {
@@ -197,6 +251,7 @@ enum class ztype : zend_type {
     NULL_T = IS_NULL,
     FALSE_T = IS_FALSE,
     TRUE_T = IS_TRUE,
+    BOOL_T = _IS_BOOL, // only for type hints
     LONG_T = IS_LONG,
     DOUBLE_T = IS_DOUBLE,
     STRING_T = IS_STRING,
@@ -284,6 +339,76 @@ protected:
 };
 static_assert(std::is_standard_layout_v<zval_l>);
 
+class zval_d : public zval_typed<ztype::DOUBLE_T> {
+public:
+    zval_d(uninitialized_t) : zval_typed<ztype::DOUBLE_T>{uninit} {}
+    zval_d(double d) {
+        ZVAL_DOUBLE(this, d)
+    }
+    double val() const {
+        return Z_DVAL_P(this);
+    }
+protected:
+    zval_d() {}
+};
+
+class zval_b : public zval_typed<ztype::BOOL_T> {
+public:
+    zval_b(uninitialized_t) : zval_typed<ztype::BOOL_T>{uninit} {}
+    zval_b(bool b) {
+        ZVAL_BOOL(this, b);
+    }
+    // the type is IS_TRUE or IS_FALSE, never the _IS_BOOL the base checks
+    zval_b(const zval_b &zv) : zval_typed<ztype::BOOL_T>{} {
+        ZVAL_COPY_VALUE(this, &zv);
+        assert(Z_TYPE_P(this) == IS_TRUE || Z_TYPE_P(this) == IS_FALSE);
+    }
+    zval_b(zval_b &&zv) : zval_b{static_cast<const zval_b &>(zv)} {
+        ZVAL_UNDEF(&zv);
+    }
+    bool val() const {
+        return Z_TYPE_P(this) == IS_TRUE;
+    }
+protected:
+    zval_b() {}
+};
+
+// zval whose type is only known at runtime
+class zval_mixed : public zval {
+public:
+    struct uninitialized_t {};
+    constexpr static auto uninit = uninitialized_t{};
+    explicit zval_mixed(uninitialized_t) {
+        ZVAL_UNDEF(this);
+    }
+    explicit zval_mixed(const zval &zv) : zval{zv} {}
+
+    // same policy as zval_typed: no implicit refcount management
+    void add_ref() noexcept {
+        Z_TRY_ADDREF_P(this);
+    }
+    void zv_dtor() noexcept {
+        zval_ptr_dtor_nogc(this);
+    }
+
+    static constexpr ztype type() noexcept {
+        return ztype::UNDEF_T; // no type hint
+    }
+};
+
+class zval_a : public zval_typed<ztype::ARRAY_T> {
+public:
+    zval_a(uninitialized_t) : zval_typed<ztype::ARRAY_T>{uninit} {}
+    explicit zval_a(HashTable *ht) {
+        ZVAL_ARR(this, ht);
+    }
+    HashTable *val() const {
+        return Z_ARRVAL_P(this);
+    }
+protected:
+    zval_a() {}
+};
+
 template<typename C>
 class zval_o : public zval_typed<ztype::OBJECT_T> {
 public:
@@ -308,8 +433,58 @@ protected:
 template<typename Z>
 zval_o(Z *zobj) -> zval_o<std::decay_t<decltype(*zobj->nat_obj)>>;
 
+/* Structs converted to and from PHP arrays list their fields, with the
+ * array keys, in a static tuple named fields:
+ *
+ *    struct endpoint {
+ *        std::string host;
+ *        long port;
+ *        std::optional<double> timeout; // key may be missing or null
+ *        static constexpr auto fields = std::tuple{
+ *                field<&endpoint::host>("host"_cs),
+ *                field<&endpoint::port>("port"_cs),
+ *                field<&endpoint::timeout>("timeout"_cs)};
+ *    };
+ *
+ * Each field goes through the usual conversions, so fields can also be
+ * reflected structs. The keys are _zs strings: nothing is hashed at runtime.
+ * Arrays converted to structs must have all the non-optional keys; other
+ * keys are ignored */
+template<auto member, typename Name>
+struct field_t {};
+
+template<auto member, char... Cs>
+constexpr field_t<member, ct_string<char, Cs...>>
+field(ct_string<char, Cs...>) noexcept {
+    return {};
+}
+
+template<typename T, typename = void>
+struct is_reflected : std::false_type {};
+template<typename T>
+struct is_reflected<T, std::void_t<decltype(T::fields)>> : std::true_type {};
+template<typename T>
+constexpr bool is_reflected_v = is_reflected<T>::value;
+
+template<typename M>
+struct member_type {};
+template<typename S, typename T>
+struct member_type<T S::*> {
+    using type = T;
+};
+template<auto member>
+using member_type_t = typename member_type<decltype(member)>::type;
+
+class immutable_array; // immutable_array.hpp
+struct pooled_string;   // string_pool.hpp
+
 /**** TO zval ****/
 namespace zval_conversions {
+    // defined in immutable_array.hpp, string_pool.hpp and refs.hpp
+    inline zval_a to_zval(const immutable_array &arr);
+    inline zval_s to_zval(pooled_string str);
+    inline zval_s to_zval(const string_ref &ref);
+    inline zval_a to_zval(const array_ref &ref);
 
     struct error_to {
         zmm::string message;
@@ -332,6 +507,29 @@ namespace zval_conversions {
         zval_l zv{static_cast<zend_long>(i)};
         return zv;
     }
+    static auto to_zval(double d) {
+        zval_d zv{d};
+        return zv;
+    }
+    static auto to_zval(bool b) {
+        zval_b zv{b};
+        return zv;
+    }
+    static auto to_zval(zstring_view sv) {
+        zval_s zv{zend_string_copy(sv)};
+        return zv;
+    }
+    static auto to_zval(const std::string &str) {
+        zval_s zv{zend_string_init(str.data(), str.size(), 0)};
+        return zv;
+    }
+    // ownership of the value is transferred
+    static auto to_zval(const zval_mixed &zv) {
+        return zv;
+    }
+    static auto to_zval(const zval_s &zv) {
+        return zv;
+    }
 
     template<typename C>
     static zval_o<C> to_zval(const PHPClass<C> &cc) {
@@ -411,6 +609,55 @@ namespace zval_conversions {
     static zval_o<C> to_zval(const std::reference_wrapper<C> &rw) {
         return to_zval(rw.get());
     }
+
+    template<typename S, typename = std::enable_if_t<is_reflected_v<S>>>
+    static zval_a to_zval(const S &s);
+
+    template<typename S, auto member, typename Name>
+    static void add_field(HashTable *ht, field_t<member, Name>, const S &s) {
+        const auto &value = s.*member;
+        zval zv;
+        if constexpr (is_optional_v<member_type_t<member>>) {
+            if (value) {
+                zv = to_zval(*value);
+            } else {
+                ZVAL_NULL(&zv);
+            }
+        } else {
+            zv = to_zval(value);
+        }
+        hash::append(ht, Name{}, &zv);
+    }
+
+    template<typename S, typename>
+    static zval_a to_zval(const S &s) {
+        constexpr auto num_fields = std::tuple_size_v<decltype(S::fields)>;
+        zval arr;
+        hash::init_assoc(&arr, num_fields);
+        try {
+            std::apply(
+                    [&](auto... fields) {
+                        (add_field(Z_ARRVAL(arr), fields, s), ...);
+                    },
+                    S::fields);
+        } catch (...) {
+            zval_ptr_dtor(&arr);
+            throw;
+        }
+        return zval_a{Z_ARRVAL(arr)};
+    }
+
+    // null if empty
+    template<typename T>
+    static zval_mixed to_zval(const std::optional<T> &opt) {
+        zval zv;
+        if (opt) {
+            zv = to_zval(*opt);
+        } else {
+            ZVAL_NULL(&zv);
+        }
+        return zval_mixed{zv};
+    }
 }
 
 template<typename T>
@@ -430,6 +677,7 @@ static auto convert_to_zval(T &&i) noexcept {
 #define ZPP_ERROR_OVERFLOW (-1)
 #define ZPP_ERROR_NO_REFERENCE (-2)
 #define ZPP_ERROR_INVALID_OBJ (-3)
+#define ZPP_ERROR_INVALID_KEY (-4)
 namespace zval_conversions {
     struct error_from_no_ctx {
         int error_code = ZPP_ERROR_OK;
@@ -437,7 +685,7 @@ namespace zval_conversions {
         const char *name;
     };
     struct error_from : public error_from_no_ctx {
-        size_t arg_num;
+        size_t arg_num; // 1-based, as for zend_wrong_parameter_*()
         zval *zv;
     };
 
@@ -491,6 +739,20 @@ namespace zval_conversions {
                                      err.arg_num);
             break;
         }
+        case ZPP_ERROR_INVALID_KEY: {
+            if (EG(exception)) {
+                break;
+            }
+            const char *space, *class_name;
+            class_name = get_active_class_name(&space);
+            zend_internal_type_error(1,
+                                     "%s%s%s() expects parameter %zu to be an "
+                                     "array with a valid '%s' element",
+                                     class_name, space,
+                                     get_active_function_name(),
+                                     err.arg_num, err.name);
+            break;
+        }
         }
     }
 
@@ -610,6 +872,87 @@ namespace zval_conversions {
         }
     };
 
+    template<>
+    struct from_zval_c<double> {
+        static double from_zval(zval &zv) {
+            double res;
+            zend_bool is_null;
+            bool success =
+                    zend_parse_arg_double(&zv, &res, &is_null, 1 /* check null */);
+            if (!success || is_null) {
+                throw error_from_no_ctx{ZPP_ERROR_WRONG_ARG, Z_EXPECTED_DOUBLE,
+                                        nullptr};
+            }
+            return res;
+        }
+    };
+
+    template<>
+    struct from_zval_c<bool> {
+        static bool from_zval(zval &zv) {
+            zend_bool res;
+            zend_bool is_null;
+            bool success = zend_parse_arg_bool(&zv, &res, &is_null,
+                                               1 /* check null */);
+            if (!success || is_null) {
+                throw error_from_no_ctx{ZPP_ERROR_WRONG_ARG, Z_EXPECTED_BOOL,
+                                        nullptr};
+            }
+            return res;
+        }
+    };
+
+    // strings are not coerced from other types: the converted string would
+    // be owned by the argument copy and outlive the call
+    template<>
+    struct from_zval_c<zstring_view> {
+        static zstring_view from_zval(zval &zv) {
+            zval *zv_deref = &zv;
+            ZVAL_DEREF(zv_deref);
+            if (Z_TYPE_P(zv_deref) != IS_STRING) {
+                throw error_from_no_ctx{ZPP_ERROR_WRONG_ARG, Z_EXPECTED_STRING,
+                                        nullptr};
+            }
+            return Z_STR_P(zv_deref);
+        }
+    };
+
+    // other types are converted on a copy, leaving the argument untouched
+    template<>
+    struct from_zval_c<std::string> {
+        static std::string from_zval(zval &zv) {
+            zval *zv_deref = &zv;
+            ZVAL_DEREF(zv_deref);
+            if (Z_TYPE_P(zv_deref) == IS_STRING) {
+                return {Z_STRVAL_P(zv_deref), Z_STRLEN_P(zv_deref)};
+            }
+            zval copy;
+            ZVAL_COPY(&copy, zv_deref);
+            zend_string *str;
+            bool success = zend_parse_arg_str(&copy, &str, 1 /* check null */);
+            std::string res;
+            if (success && str) {
+                res.assign(ZSTR_VAL(str), ZSTR_LEN(str));
+            }
+            zval_ptr_dtor(&copy);
+            if (!success || !str) {
+                throw error_from_no_ctx{ZPP_ERROR_WRONG_ARG, Z_EXPECTED_STRING,
+                                        nullptr};
+            }
+            return res;
+        }
+    };
+
+    // borrowed: the argument keeps ownership
+    template<>
+    struct from_zval_c<zval_mixed> {
+        static zval_mixed from_zval(zval &zv) {
+            zval *zv_deref = &zv;
+            ZVAL_DEREF(zv_deref);
+            return zval_mixed{*zv_deref};
+        }
+    };
+
     // references
     template<typename T>
     struct from_zval_c<std::optional<T>> {
@@ -739,6 +1082,50 @@ namespace zval_conversions {
         }
     };
 
+    // reflected structs
+    template<typename S, auto member, typename Name>
+    static void read_field(HashTable *ht, field_t<member, Name>, S &s) {
+        using M = member_type_t<member>;
+        zval *value = hash::find(ht, Name{});
+        if (!value) {
+            if constexpr (is_optional_v<M>) {
+                return;
+            } else {
+                throw error_from_no_ctx{ZPP_ERROR_INVALID_KEY,
+                                        Z_EXPECTED_ARRAY, Name{}};
+            }
+        }
+        ZVAL_DEREF(value);
+        try {
+            s.*member = zval_conversions::from_zval<M>(*value);
+        } catch (const error_from_no_ctx &err) {
+            if (err.error_code == ZPP_ERROR_INVALID_KEY) {
+                throw; // from a nested struct: report the innermost key
+            }
+            throw error_from_no_ctx{ZPP_ERROR_INVALID_KEY, err.expected_type,
+                                    Name{}};
+        }
+    }
+
+    template<typename S>
+    struct from_zval_c<S, std::enable_if_t<is_reflected_v<S>>> {
+        static S from_zval(zval &zv) {
+            zval *zv_deref = &zv;
+            ZVAL_DEREF(zv_deref);
+            if (Z_TYPE_P(zv_deref) != IS_ARRAY) {
+                throw error_from_no_ctx{ZPP_ERROR_WRONG_ARG, Z_EXPECTED_ARRAY,
+                                        nullptr};
+            }
+            S s{};
+            std::apply(
+                    [&](auto... fields) {
+                        (read_field(Z_ARRVAL_P(zv_deref), fields, s), ...);
+                    },
+                    S::fields);
+            return s;
+        }
+    };
+
     // from outer functions
     template<typename R>
     static auto from_zval_entry(size_t idx, zval& zv) {
@@ -755,8 +1142,8 @@ namespace zval_conversions {
         try {
             return from_zval<R>(*zvp);
         } catch (const error_from_no_ctx &err) {
-            throw error_from{{err.error_code, err.expected_type, nullptr}, idx,
-                             &zv};
+            throw error_from{{err.error_code, err.expected_type, err.name},
+                             idx + 1, &zv};
         }
     }
 
@@ -774,10 +1161,20 @@ namespace zval_conversions {
             }
             return args[i];
         };
+        auto conv_arg = [&](auto idx) {
+            constexpr size_t i = decltype(idx)::value;
+            using P = std::tuple_element_t<i, Ps>;
+            if constexpr (is_variadic_v<std::remove_cv_t<P>>) {
+                // not converted here: a view of the remaining arguments
+                return std::remove_cv_t<P>{
+                        args + i, num_args > i ? num_args - i : 0, i};
+            } else {
+                return from_zval_entry<P>(i, zval_or_null_zval(i));
+            }
+        };
         auto do_conv = [&]() {
             return std::make_tuple(
-                    from_zval_entry<std::tuple_element_t<Is, Ps>>(
-                        Is, zval_or_null_zval(Is))...);
+                    conv_arg(std::integral_constant<size_t, Is>{})...);
         };
         try {
             return std::optional{do_conv()};
@@ -789,6 +1186,76 @@ namespace zval_conversions {
 
 } // namespace zval_conversions
 
+/* Trailing parameter taking the remaining arguments of the call, which are
+ * not copied: it's a view of the call frame and each element is converted
+ * when read. Conversion failures raise the usual TypeError once the bound
+ * function returns (or throws) the exception:
+ *
+ *    static long sum_all(variadic<long> values) {
+ *        long sum = 0;
+ *        for (long v : values) sum += v;
+ *        return sum;
+ *    }
+ *
+ * Only valid during the call */
+template<typename T>
+class variadic {
+    static_assert(!is_ref_type<std::remove_cv_t<
+                          typename is_optional<T>::base_type>>::value,
+                  "variadic arguments are taken by value");
+
+public:
+    variadic(zval *args, size_t count, size_t first_arg) noexcept
+        : args{args}, count{count}, first_arg{first_arg} {}
+
+    size_t size() const noexcept {
+        return count;
+    }
+    bool empty() const noexcept {
+        return count == 0;
+    }
+
+    T operator[](size_t i) const {
+        return zval_conversions::from_zval_entry<T>(first_arg + i, args[i]);
+    }
+
+    // the arguments, unconverted
+    zval *data() const noexcept {
+        return args;
+    }
+
+    class iterator {
+    public:
+        iterator(const variadic *v, size_t i) noexcept : v{v}, i{i} {}
+        T operator*() const {
+            return (*v)[i];
+        }
+        iterator &operator++() noexcept {
+            i++;
+            return *this;
+        }
+        bool operator!=(const iterator &oth) const noexcept {
+            return i != oth.i;
+        }
+
+    private:
+        const variadic *v;
+        size_t i;
+    };
+
+    iterator begin() const noexcept {
+        return {this, 0};
+    }
+    iterator end() const noexcept {
+        return {this, count};
+    }
+
+private:
+    zval *args;
+    size_t count;
+    size_t first_arg;
+};
+
 // TODO: this is for params. We prob need different conversions
 // in other circumstances
 template<typename Ps /* tuple */>
@@ -805,28 +1272,92 @@ class php_arginfo {
 
     php_arginfo() = delete;
 
-    struct php_arg_info_base {
-        zend_internal_function_info gen_info;
-
-        constexpr php_arg_info_base() noexcept
-            : gen_info{arg_traits::min_args, 0, 0 /* TODO: ret by ref */, 0} {}
-    };
-
     // we need to generalize zend_internal_arg_info with a union because
     // a cast of char * into zend_type (aka uintptr_r) is not allowed in
     // constexpr code
+    union type_union {
+        zend_type ztype;
+        const char *class_name;
+        constexpr type_union(zend_type ztype) : ztype(ztype) {}
+        constexpr type_union(const char *cname) : class_name(cname) {}
+    };
+
     struct zend_internal_arg_info_gen {
         const char *name;
-        union type_union {
-            zend_type ztype;
-            const char *class_name;
-            constexpr type_union(zend_type ztype) : ztype(ztype) {}
-            constexpr type_union(const char *cname) : class_name(cname) {}
-        } type;
+        type_union type;
         zend_uchar pass_by_reference;
         zend_bool is_variadic;
     };
 
+    struct zend_internal_function_info_gen {
+        zend_uintptr_t required_num_args;
+        type_union type;
+        zend_bool return_reference;
+        zend_bool _is_variadic;
+    };
+
+    /* create optional hint for classes: ?<class name> */
+    template<char ... C>
+    struct hint_for_opt_cls_holder {
+        constexpr static const char value[] { '?', C..., 0 };
+    };
+    template<char ... Cs>
+    static constexpr auto
+    create_hint_for_opt_cls(ct_string<char, Cs...>) {
+        return hint_for_opt_cls_holder<Cs...>::value;
+    }
+
+    /* the return type, from the same mapping as the parameters, lets
+     * opcache infer the type of the call results. Constructors can't declare
+     * one */
+    using ret_base_type = typename is_optional<typename FT::ret_type>::base_type;
+    static constexpr bool ret_nullable = is_optional_v<typename FT::ret_type>;
+
+    static constexpr type_union return_type() {
+        if constexpr (FT::is_ctor::value) {
+            return zend_type{0};
+        } else if constexpr (FT::is_void::value) {
+            return ZEND_TYPE_ENCODE(IS_VOID, 0);
+        } else {
+            using conv_type =
+                    decltype(convert_to_zval(std::declval<ret_base_type>()));
+            if constexpr (conv_type::type() == ztype::OBJECT_T) {
+                constexpr auto cname =
+                        conv_type::nat_class_t::get_php_class_name();
+                if constexpr (ret_nullable) {
+                    return create_hint_for_opt_cls(cname);
+                } else {
+                    return static_cast<const char *>(cname);
+                }
+            } else if constexpr (conv_type::type() == ztype::REFERENCE_T ||
+                                 conv_type::type() == ztype::UNDEF_T) {
+                return zend_type{0}; // no type
+            } else {
+                return ZEND_TYPE_ENCODE(
+                        static_cast<zend_type>(conv_type::type()),
+                        ret_nullable);
+            }
+        }
+    }
+
+    static constexpr bool return_reference() {
+        if constexpr (FT::is_void::value) {
+            return false;
+        } else {
+            using conv_type =
+                    decltype(convert_to_zval(std::declval<ret_base_type>()));
+            return conv_type::type() == ztype::REFERENCE_T;
+        }
+    }
+
+    struct php_arg_info_base {
+        zend_internal_function_info_gen gen_info;
+
+        constexpr php_arg_info_base() noexcept
+            : gen_info{arg_traits::min_args, return_type(), return_reference(),
+                       0} {}
+    };
+
     struct php_arginfo_agg_no_args : php_arg_info_base {
         static constexpr bool no_args = true;
 
@@ -861,22 +1392,24 @@ class php_arginfo {
                 std::make_index_sequence<arg_traits::max_args>{});
         static constexpr auto expl_param_names = FT::arg_names::array;
 
-        /* create optional hint for classes: ?<class name> */
-        template<char ... C>
-        struct hint_for_opt_cls_holder {
-            constexpr static const char value[] { '?', C..., 0 };
-        };
-        template<char ... Cs>
-        static constexpr auto
-        create_hint_for_opt_cls(ct_string<char, Cs...>) {
-            return hint_for_opt_cls_holder<Cs...>::value;
-        }
-
         template<size_t i>
         static constexpr auto to_zend_internal_arg_info() {
-            using arg_type = typename arg_traits::template elem_base_type<i>;
+            // for variadic<T>, the type of each of the extra arguments
+            using var = is_variadic<std::remove_cv_t<
+                    typename arg_traits::template elem_type<i>>>;
+            using arg_type = std::conditional_t<
+                    var::value,
+                    typename is_optional<typename var::elem_type>::base_type,
+                    typename arg_traits::template elem_base_type<i>>;
             constexpr auto num_prov_arg_names = FT::arg_names::size;
-            constexpr auto is_opt = arg_traits::template is_elem_optional_v<i>;
+            // in-place refs take null (and undefined variables) as empty
+            constexpr auto is_opt =
+                    var::value ? is_optional_v<typename var::elem_type>
+                               : arg_traits::template is_elem_optional_v<i> ||
+                                         is_in_place_ref_v<std::remove_cv_t<
+                                                 arg_type>>;
+            static_assert(!var::value || i + 1 == arg_traits::max_args,
+                          "variadic must be the last parameter");
             using conv_type = decltype(convert_to_zval(
                     std::declval<arg_type>()));
             // TODO: refs for classes
@@ -905,7 +1438,7 @@ class php_arginfo {
                         arg_name,
                         hint,
                         0,     // TODO: refs for classes
-                        0      // TODO: variadic
+                        var::value
                 };
                 return r;
             } else {
@@ -915,7 +1448,7 @@ class php_arginfo {
                                 static_cast<zend_type>(conv_type::type()),
                                 is_opt),
                         is_ref,
-                        0, // TODO: variadic
+                        var::value,
                 };
                 return r;
             }
@@ -939,6 +1472,20 @@ static_assert((php_arginfo<cpp_func_traits<void (*)(std::optional<int>)>>::type{
               "php_arginfo should be statically instantiable");
 static_assert((php_arginfo<cpp_func_traits<void (*)()>>::type{}).gen_info.required_num_args == 0,
               "php_arginfo should be statically instantiable (0 args)");
+static_assert((php_arginfo<cpp_func_traits<long (*)()>>::type{})
+                              .gen_info.type.ztype == ZEND_TYPE_ENCODE(IS_LONG, 0),
+              "return type from the conversion to zval");
+static_assert((php_arginfo<cpp_func_traits<std::optional<double> (*)()>>::type{})
+                              .gen_info.type.ztype ==
+                      ZEND_TYPE_ENCODE(IS_DOUBLE, 1),
+              "nullable return type for std::optional");
+static_assert((php_arginfo<cpp_func_traits<void (*)(int, variadic<long>)>>::type{})
+                              .arg_info[1]
+                              .is_variadic,
+              "variadic<T> declares a variadic parameter");
+static_assert((php_arginfo<cpp_func_traits<void (*)(int, variadic<long>)>>::type{})
+                              .gen_info.required_num_args == 1,
+              "variadic<T> is not required");
 static_assert(!php_arginfo<cpp_func_traits<void (*)(int)>>::type::no_args,
               "Selects args variant");
 static_assert(php_arginfo<cpp_func_traits<void (*)()>>::type::no_args,
@@ -970,36 +1517,257 @@ static decltype(auto) call_tuple(F f, const T &t) {
     return call_tuple(f, t, std::make_index_sequence<size>{});
 }
 
+/* Converts the arguments, calls func and converts its result.
+ *
+ * args is normally the call frame itself (ZEND_CALL_ARG), not a copy made
+ * with zend_get_parameters_array_ex(): the frame outlives the call, the
+ * conversions leave its zvals as they are (coercions work on copies, and
+ * by-reference parameters write to the referenced value), and views such
+ * as zstring_view and variadic<T> can point into it. That saves
+ * copying every argument, and bounding the copy by the number of
+ * parameters, which variadic bindings don't have */
+template<typename FT, typename FT::func_type func>
+static void call_free_function(size_t num_args, zval *args,
+                               zval *return_value) {
+    // must last until after the call
+    auto opt_tuple = convert_from_zval<typename FT::arg_traits::types>(
+            num_args, args);
+    if (!opt_tuple.has_value()) {
+        return;
+    }
+
+    const auto &tuple_conv_args = opt_tuple.value();
+    try {
+        if constexpr (FT::is_void::value) {
+            call_tuple(func, tuple_conv_args);
+        } else {
+            decltype(auto) res = call_tuple(func, tuple_conv_args);
+            *return_value = convert_to_zval(std::forward<decltype(res)>(res));
+        }
+    } catch (const zval_conversions::error_from &err) {
+        // from a variadic argument, converted during the call
+        zval_conversions::handle_error(err);
+    }
+}
+
 template<typename FT, typename FT::func_type func>
 static inline zif_handler wrap_free_function() {
-    zif_handler wrapped = [](INTERNAL_FUNCTION_PARAMETERS) -> void {
+    static constexpr zif_handler body = [](INTERNAL_FUNCTION_PARAMETERS) {
         using arg_traits = typename FT::arg_traits;
-        constexpr auto max_params = arg_traits::max_args;
-        constexpr auto min_params = arg_traits::min_args;
-
         auto given_args = ZEND_NUM_ARGS();
-        if (given_args > max_params || given_args < min_params) {
-            zend_wrong_parameters_count_exception(min_params, max_params);
+        if (!arg_traits::accepts(given_args)) {
+            zend_wrong_parameters_count_exception(arg_traits::min_args,
+                                                  arg_traits::max_params);
             return;
         }
 
-        std::array<zval, max_params> args_zv;
-        zend_get_parameters_array_ex(given_args, args_zv.data());
-        // must last until after the call
-        auto opt_tuple = convert_from_zval<
-                typename arg_traits::types>(given_args, args_zv.data());
-        if (!opt_tuple.has_value()) {
-            return;
+        // the arguments are converted where they are, in the call frame
+        call_free_function<FT, func>(
+                given_args, ZEND_CALL_ARG(execute_data, 1), return_value);
+    };
+    return [](INTERNAL_FUNCTION_PARAMETERS) -> void {
+        interruptible(body, INTERNAL_FUNCTION_PARAM_PASSTHRU);
+    };
+}
+
+/**** visiting zvals ****/
+/* Handlers called by visit(), which walks nested arrays and objects without
+ * recursing. Derive from this and define the handlers of interest; all of
+ * them return false to stop the walk.
+ *
+ * Each array or object gets a begin_ call, then, for each element, its key
+ * (on_index or on_key) followed by the element, then the end_ call. Object
+ * keys are the raw property names (mangled for private and protected
+ * properties). References are followed */
+struct zval_visitor {
+    bool on_null() { return true; }
+    bool on_bool(bool) { return true; }
+    bool on_long(zend_long) { return true; }
+    bool on_double(double) { return true; }
+    bool on_string(zstring_view) { return true; }
+    bool on_other(const zval &) { return true; } // resources
+    bool on_index(zend_ulong) { return true; }
+    bool on_key(zstring_view) { return true; }
+    bool begin_array(const HashTable *) { return true; }
+    bool end_array() { return true; }
+    bool begin_object(const zend_object *) { return true; }
+    bool end_object() { return true; }
+    // an array or object found inside itself; true skips it
+    bool on_recursion(const zval &) { return false; }
+};
+
+namespace visit_detail {
+template<typename V>
+class walker {
+public:
+    explicit walker(V &visitor) : visitor{visitor} {
+        stack.reserve(16);
+    }
+    walker(const walker &) = delete;
+    walker &operator=(const walker &) = delete;
+
+    // containers still open after a stop are released here
+    ~walker() {
+        for (const frame &f : stack) {
+            if (f.guard) {
+                GC_UNPROTECT_RECURSION(f.guard);
+            }
         }
+    }
 
-        const auto &tuple_conv_args = opt_tuple.value();
-        if constexpr (FT::is_void::value) {
-            call_tuple(func, tuple_conv_args);
-        } else {
-            auto res = call_tuple(func, tuple_conv_args);
-            *return_value = convert_to_zval(res);
+    bool run(zval *root) {
+        if (!enter(root)) {
+            return false;
         }
+        while (!stack.empty()) {
+            zval *child;
+            if (!next_container(child)) {
+                return false;
+            }
+            if (child) {
+                if (!enter(child)) {
+                    return false;
+                }
+            } else if (!leave()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    struct frame {
+        HashTable *ht;
+        zend_refcounted *guard; // recursion protected; null if immutable
+        uint32_t pos;
+        bool packed;
+        bool object;
     };
-    return wrapped;
+
+    static bool is_container(const zval *zv) {
+        return Z_TYPE_P(zv) == IS_ARRAY || Z_TYPE_P(zv) == IS_OBJECT;
+    }
+
+    bool scalar(zval *zv) {
+        switch (static_cast<ztype>(Z_TYPE_P(zv))) {
+        case ztype::UNDEF_T:
+        case ztype::NULL_T:
+            return visitor.on_null();
+        case ztype::FALSE_T:
+            return visitor.on_bool(false);
+        case ztype::TRUE_T:
+            return visitor.on_bool(true);
+        case ztype::LONG_T:
+            return visitor.on_long(Z_LVAL_P(zv));
+        case ztype::DOUBLE_T:
+            return visitor.on_double(Z_DVAL_P(zv));
+        case ztype::STRING_T:
+            return visitor.on_string(Z_STR_P(zv));
+        default:
+            return visitor.on_other(*zv);
+        }
+    }
+
+    bool enter(zval *zv) {
+        ZVAL_DEREF(zv);
+        if (Z_TYPE_P(zv) == IS_ARRAY) {
+            HashTable *ht = Z_ARRVAL_P(zv);
+            if (GC_IS_RECURSIVE(ht)) {
+                return visitor.on_recursion(*zv);
+            }
+            if (!visitor.begin_array(ht)) {
+                return false;
+            }
+            zend_refcounted *guard = nullptr;
+            if (!(GC_FLAGS(ht) & GC_IMMUTABLE)) {
+                guard = reinterpret_cast<zend_refcounted *>(ht);
+                GC_PROTECT_RECURSION(guard);
+            }
+            stack.push_back(frame{ht, guard, 0, HT_IS_PACKED(ht), false});
+            return true;
+        }
+        if (Z_TYPE_P(zv) == IS_OBJECT) {
+            zend_object *obj = Z_OBJ_P(zv);
+            if (GC_IS_RECURSIVE(obj)) {
+                return visitor.on_recursion(*zv);
+            }
+            if (!visitor.begin_object(obj)) {
+                return false;
+            }
+            HashTable *props = Z_OBJPROP_P(zv);
+            if (!props) {
+                return visitor.end_object();
+            }
+            auto *guard = reinterpret_cast<zend_refcounted *>(obj);
+            GC_PROTECT_RECURSION(guard);
+            stack.push_back(frame{props, guard, 0, false, true});
+            return true;
+        }
+        return scalar(zv);
+    }
+
+    /* Visits the keys and scalars of the top container until an element
+     * that is an array or an object (returned in child) or the end (child is
+     * null). Packed arrays skip the key lookups */
+    bool next_container(zval *&child) {
+        frame &f = stack.back();
+        Bucket *const data = f.ht->arData;
+        const uint32_t used = f.ht->nNumUsed;
+        child = nullptr;
+        while (f.pos < used) {
+            uint32_t i = f.pos++;
+            zval *val = &data[i].val;
+            if (Z_TYPE_P(val) == IS_INDIRECT) { // declared properties
+                val = Z_INDIRECT_P(val);
+            }
+            if (Z_TYPE_P(val) == IS_UNDEF) {
+                continue;
+            }
+            bool ok;
+            if (f.packed) {
+                ok = visitor.on_index(i);
+            } else if (data[i].key) {
+                ok = visitor.on_key(data[i].key);
+            } else {
+                ok = visitor.on_index(data[i].h);
+            }
+            if (!ok) {
+                return false;
+            }
+            zval *deref = val;
+            ZVAL_DEREF(deref);
+            if (is_container(deref)) {
+                child = deref;
+                return true;
+            }
+            if (!scalar(deref)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool leave() {
+        frame f = stack.back();
+        stack.pop_back();
+        if (f.guard) {
+            GC_UNPROTECT_RECURSION(f.guard);
+        }
+        return f.object ? visitor.end_object() : visitor.end_array();
+    }
+
+    V &visitor;
+    zmm::vector<frame> stack;
+};
+} // namespace visit_detail
+
+/* Walks value depth-first, with an explicit stack instead of recursion, so
+ * deeply nested input can't overflow the C stack. Returns false if a handler
+ * stopped the walk */
+template<typename V>
+bool visit(zval &value, V &visitor) {
+    static_assert(std::is_base_of_v<zval_visitor, V>,
+                  "visitors derive from zval_visitor");
+    return visit_detail::walker<V>{visitor}.run(&value);
 }
 }
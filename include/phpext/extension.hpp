@@ -5,8 +5,17 @@
 #include <array>
 #include <tuple>
 #include <utility>
+#include "bindings.hpp"
 #include "build_traits.hpp"
+#include "compact.hpp"
+#include "constants.hpp"
 #include "conversions.hpp"
+#include "memoize.hpp"
+#include "overloads.hpp"
+#include "policies.hpp"
+#include "request_table.hpp"
+#include "string_pool.hpp"
+#include "vectorized.hpp"
 
 namespace zend {
     
@@ -15,6 +24,7 @@ struct empty_globals {};
 template<typename E, typename G = empty_globals>
 class PHPExtension {
     static inline std::vector<zend_function_entry> global_functions;
+    static inline std::vector<constant_def> constants;
     static inline zend_module_entry zme;
 
     template<typename T = E, typename = void>
@@ -22,18 +32,62 @@ class PHPExtension {
     template<typename T>
     struct has_ini_entries<T, decltype((void)T::ini_entries)> : std::true_type {};
 
+    template<typename T = E, typename = void>
+    struct has_snapshots : std::false_type {};
+    template<typename T>
+    struct has_snapshots<T, decltype((void)T::snapshots)> : std::true_type {};
+
+    template<typename F>
+    static void for_each_snapshot([[maybe_unused]] F f) {
+        if constexpr (has_snapshots<>::value) {
+            std::apply([&](auto &... snapshot) { (f(snapshot), ...); },
+                       E::snapshots);
+        }
+    }
+
+    template<typename T = E, typename = void>
+    struct has_persistents : std::false_type {};
+    template<typename T>
+    struct has_persistents<T, decltype((void)T::persistents)> : std::true_type {};
+
+    template<typename T = E, typename = void>
+    struct has_function_defs : std::false_type {};
+    template<typename T>
+    struct has_function_defs<T, decltype((void)T::function_defs)>
+        : std::true_type {};
+
+    static const zend_function_entry *function_table() {
+        if constexpr (has_function_defs<>::value) {
+            static const auto declared = bindings_detail::make_table(
+                    E::function_defs, [](const auto &def) {
+                        return function_entry(def);
+                    });
+            return bindings_detail::merge_table(declared, global_functions);
+        } else {
+            global_functions.emplace_back();
+            return global_functions.data();
+        }
+    }
+
+    template<typename F>
+    static void for_each_persistent([[maybe_unused]] F f) {
+        if constexpr (has_persistents<>::value) {
+            std::apply([&](auto &... persistent) { (f(persistent), ...); },
+                       E::persistents);
+        }
+    }
+
     static void make_zme() {
         E::register_php_methods();
-        global_functions.emplace_back();
         zme = {STANDARD_MODULE_HEADER_EX,
                nullptr, // ini entry
                nullptr, // deps
                E::name,
-               global_functions.data(),
+               function_table(),
                prv_startup,
-               E::shutdown,
-               E::request_start,
-               E::request_end,
+               prv_shutdown,
+               prv_request_start,
+               prv_request_end,
                [](zend_module_entry *) { E::extension_info(); },
                E::version,
                sizeof(G),
@@ -55,7 +109,7 @@ class PHPExtension {
 
     template<typename A, typename T, size_t ... Is>
     static void copy_n_ini_def(A& arr, T& tuple, std::index_sequence<Is...>) {
-        arr.operator[](Is...) = std::get<Is...>(tuple).get_entry();
+        ((arr[Is] = std::get<Is>(tuple).get_entry()), ...);
     }
 
     static int prv_startup(int type, int module_number) {
@@ -75,8 +129,40 @@ class PHPExtension {
             }
         }
 
+        zs_detail::intern_all();
+        for (const constant_def &def : constants) {
+            register_module_constant(def, module_number);
+        }
+        for_each_snapshot([](auto &snapshot) { snapshot.startup(); });
+        bool persistents_ok = true;
+        for_each_persistent([&](auto &persistent) {
+            persistents_ok = persistent.startup() && persistents_ok;
+        });
+        if (!persistents_ok) {
+            return FAILURE;
+        }
+
         return E::startup(type, module_number);
     }
+
+    static int prv_shutdown(int type, int module_number) {
+        int res = E::shutdown(type, module_number);
+        for_each_snapshot([](auto &snapshot) { snapshot.shutdown(); });
+        for_each_persistent([](auto &persistent) { persistent.shutdown(); });
+        return res;
+    }
+
+    static int prv_request_start(int type, int module_number) {
+        for_each_snapshot([](auto &snapshot) { snapshot.request_start(); });
+        return E::request_start(type, module_number);
+    }
+
+    static int prv_request_end(int type, int module_number) {
+        int res = E::request_end(type, module_number);
+        for_each_snapshot([](auto &snapshot) { snapshot.request_end(); });
+        request_table::reset_all();
+        return res;
+    }
 protected:
     using globals_type = std::conditional_t<zts_build::value, ts_rsrc_id, G>;
     static inline globals_type _globals;
@@ -112,13 +198,62 @@ protected:
 
     static void register_php_methods() noexcept {}
 
-    template<auto func, typename A = arg_names_empty_t>
-    static void reg_function(const char *name) {
+    template<auto func, typename A = arg_names_empty_t, typename... Policies>
+    static void reg_function(const char *name, Policies...) {
+        global_functions.push_back(
+                function_entry(function_def<func, A, Policies...>{name}));
+    }
+
+    template<auto func, typename A, typename... Policies>
+    static zend_function_entry
+    function_entry(const function_def<func, A, Policies...> &def) {
         using FT = cpp_func_traits<decltype(func), A>;
-        auto zif_handler = wrap_free_function<FT, func>();
+        constexpr auto make = [] {
+            if constexpr (use_compact<FT, Policies...>()) {
+                return &wrap_compact_function<FT, func>;
+            } else {
+                return &wrap_free_function<FT, func>;
+            }
+        }();
+        auto zif_handler = make();
+        if constexpr (has_policy<memoize_t, Policies...>) {
+            zif_handler = wrap_memoized<make>();
+        }
         const auto arginfo = php_arg_info_holder<FT>::as_ziai_array();
         zend_function_entry zfe = {
-            name, zif_handler, arginfo, FT::arg_traits::max_args, 0
+            def.name, zif_handler, arginfo, FT::arg_traits::max_args, 0
+        };
+        return zfe;
+    }
+
+    // funcs are tried in order; see overloads.hpp
+    template<auto... funcs>
+    static void reg_overloads(const char *name) {
+        using set = overload_detail::overload_set<
+                cpp_func_traits<decltype(funcs)>...>;
+        static const zif_handler handlers[] = {
+                wrap_free_function<cpp_func_traits<decltype(funcs)>, funcs>()...};
+        zend_function_entry zfe = {
+            name,
+            [](INTERNAL_FUNCTION_PARAMETERS) -> void {
+                set::dispatch(handlers, INTERNAL_FUNCTION_PARAM_PASSTHRU);
+            },
+            set::arginfo(), set::max_args, 0
+        };
+        global_functions.push_back(zfe);
+    }
+
+    // registered at startup
+    static void reg_constant(const char *name, constant_value value) {
+        constants.push_back({name, value});
+    }
+
+    // func must take and return a number; see vectorized.hpp
+    template<auto func>
+    static void reg_vectorized_function(const char *name) {
+        using FT = cpp_func_traits<decltype(func)>;
+        zend_function_entry zfe = {
+            name, wrap_vectorized_function<FT, func>(), vectorized_arginfo, 1, 0
         };
         global_functions.push_back(zfe);
     }
@@ -137,9 +272,10 @@ public:
         }
     }
 
+    // built on the first call
     static zend_module_entry *descriptor() {
-        make_zme();
-        return &zme;
+        static zend_module_entry *const built = (make_zme(), &zme);
+        return built;
     }
 };
 }
@@ -0,0 +1,69 @@
+#pragma once
+#include <php.h>
+#include "strings.hpp"
+
+namespace zend {
+
+/* HashTable operations with compile-time keys. The keys are _zs strings:
+ * interned, with the hash computed by the compiler, so none of these
+ * functions hashes or refcounts a key at runtime.
+ *
+ *    zval *timeout = hash::find(opts, "timeout"_cs);
+ *
+ *    hash::init_assoc(return_value, 2);
+ *    hash::append(Z_ARRVAL_P(return_value), "host"_cs, &host_zv);
+ *    hash::append(Z_ARRVAL_P(return_value), "port"_cs, &port_zv);
+ *
+ * The functions taking a zend_string key expect an interned string whose
+ * hash has already been computed (_zs literals, zs(), ...). The keys are only
+ * interned once the extension has started: don't use them earlier */
+namespace hash {
+
+inline zval *find(const HashTable *ht, zend_string *key) {
+    ZEND_ASSERT(ZSTR_IS_INTERNED(key) && ZSTR_H(key));
+    return zend_hash_find_ex(ht, key, 1);
+}
+
+template<char... Cs>
+inline zval *find(const HashTable *ht, ct_string<char, Cs...> key) {
+    return find(ht, zs(key));
+}
+
+// adds or replaces; the table takes over the value
+inline zval *update(HashTable *ht, zend_string *key, zval *value) {
+    ZEND_ASSERT(ZSTR_IS_INTERNED(key) && ZSTR_H(key));
+    return zend_hash_update(ht, key, value);
+}
+
+template<char... Cs>
+inline zval *update(HashTable *ht, ct_string<char, Cs...> key, zval *value) {
+    return update(ht, zs(key), value);
+}
+
+/* Fastest insert, for building new arrays: the key must not be in the table
+ * yet, which is not checked. The table takes over the value */
+inline zval *append(HashTable *ht, zend_string *key, zval *value) {
+    ZEND_ASSERT(ZSTR_IS_INTERNED(key) && ZSTR_H(key));
+    if (UNEXPECTED(HT_FLAGS(ht) & HASH_FLAG_UNINITIALIZED)) {
+        zend_hash_real_init_mixed(ht);
+    } else if (UNEXPECTED(HT_IS_PACKED(ht))) {
+        zend_hash_packed_to_hash(ht);
+    }
+    if (UNEXPECTED(ht->nNumUsed >= ht->nTableSize)) {
+        zend_hash_extend(ht, ht->nNumUsed + 1, 0);
+    }
+    return _zend_hash_append_ex(ht, key, value, 1 /* interned */);
+}
+
+template<char... Cs>
+inline zval *append(HashTable *ht, ct_string<char, Cs...> key, zval *value) {
+    return append(ht, zs(key), value);
+}
+
+// new array sized for num_keys string keys
+inline void init_assoc(zval *arr, uint32_t num_keys) {
+    array_init_size(arr, num_keys);
+    zend_hash_real_init_mixed(Z_ARRVAL_P(arr));
+}
+} // namespace hash
+}
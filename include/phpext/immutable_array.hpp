@@ -0,0 +1,161 @@
+#pragma once
+#include <php.h>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "conversions.hpp"
+
+namespace zend {
+
+/* PHP array built once, in persistent memory, and returned by bindings as
+ * is: no copy and no refcounting. Like the arrays opcache keeps for
+ * literals, it's flagged immutable with a refcount of 2, so a script writing
+ * to it gets a separated copy. Nothing writes to its memory after it's built,
+ * so forked workers keep sharing the pages.
+ *
+ * Build it with immutable_array_builder during the extension's startup: the
+ * strings are interned in the engine's permanent table, which is only
+ * possible at that point. Destroy it (reset()) in shutdown */
+class immutable_array {
+public:
+    immutable_array() noexcept = default;
+    immutable_array(immutable_array &&oth) noexcept
+        : ht{std::exchange(oth.ht, nullptr)} {}
+    immutable_array &operator=(immutable_array &&oth) noexcept {
+        reset();
+        ht = std::exchange(oth.ht, nullptr);
+        return *this;
+    }
+    ~immutable_array() {
+        reset();
+    }
+
+    void reset() noexcept {
+        if (ht) {
+            destroy(ht);
+            ht = nullptr;
+        }
+    }
+
+    explicit operator bool() const noexcept {
+        return ht != nullptr;
+    }
+    const HashTable *get() const noexcept {
+        return ht;
+    }
+
+private:
+    explicit immutable_array(HashTable *ht) noexcept : ht{ht} {}
+
+    // keys and strings are interned and die with the interned string table
+    static void destroy(HashTable *ht) noexcept {
+        zval *val;
+        ZEND_HASH_FOREACH_VAL(ht, val) {
+            if (Z_TYPE_P(val) == IS_ARRAY) {
+                destroy(Z_ARRVAL_P(val));
+            }
+        } ZEND_HASH_FOREACH_END();
+        zend_hash_destroy(ht);
+        pefree(ht, 1);
+    }
+
+    HashTable *ht = nullptr;
+
+    friend class immutable_array_builder;
+    friend zval_a zval_conversions::to_zval(const immutable_array &);
+};
+
+/* Values can be null (nullptr), booleans, integers, floats, strings and other
+ * immutable_arrays, which are moved into the new one. String keys that look
+ * like integers become integer keys, as in PHP */
+class immutable_array_builder {
+public:
+    explicit immutable_array_builder(uint32_t size_hint = 8) {
+        ht = static_cast<HashTable *>(pemalloc(sizeof(HashTable), 1));
+        zend_hash_init(ht, size_hint, nullptr, nullptr, 1);
+    }
+    immutable_array_builder(const immutable_array_builder &) = delete;
+    immutable_array_builder &operator=(const immutable_array_builder &) =
+            delete;
+    ~immutable_array_builder() {
+        if (ht) {
+            immutable_array::destroy(ht);
+        }
+    }
+
+    template<typename V>
+    immutable_array_builder &add(std::string_view key, V &&value) {
+        zval zv = element(std::forward<V>(value));
+        zend_symtable_update(ht, intern(key), &zv);
+        return *this;
+    }
+
+    template<typename V>
+    immutable_array_builder &add(zend_long index, V &&value) {
+        zval zv = element(std::forward<V>(value));
+        zend_hash_index_update(ht, index, &zv);
+        return *this;
+    }
+
+    template<typename V>
+    immutable_array_builder &push(V &&value) {
+        zval zv = element(std::forward<V>(value));
+        zend_hash_next_index_insert(ht, &zv);
+        return *this;
+    }
+
+    immutable_array build() {
+        GC_SET_REFCOUNT(ht, 2);
+        GC_TYPE_INFO(ht) =
+                IS_ARRAY |
+                ((IS_ARRAY_IMMUTABLE | IS_ARRAY_PERSISTENT) << GC_FLAGS_SHIFT);
+        return immutable_array{std::exchange(ht, nullptr)};
+    }
+
+private:
+    static zend_string *intern(std::string_view str) {
+        zend_string *zs = zend_string_init_interned(str.data(), str.size(), 1);
+        ZEND_ASSERT(GC_FLAGS(zs) & IS_STR_PERMANENT); // built in startup
+        return zs;
+    }
+
+    template<typename V>
+    static zval element(V &&value) {
+        using T = std::decay_t<V>;
+        zval zv;
+        if constexpr (std::is_same_v<T, std::nullptr_t>) {
+            ZVAL_NULL(&zv);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            ZVAL_BOOL(&zv, value);
+        } else if constexpr (std::is_integral_v<T>) {
+            ZVAL_LONG(&zv, static_cast<zend_long>(value));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            ZVAL_DOUBLE(&zv, static_cast<double>(value));
+        } else if constexpr (std::is_same_v<T, immutable_array>) {
+            static_assert(std::is_rvalue_reference_v<V &&>,
+                          "nested arrays are moved in");
+            ZVAL_ARR(&zv, std::exchange(value.ht, nullptr));
+            Z_TYPE_FLAGS(zv) = 0; // not refcounted
+        } else {
+            static_assert(std::is_convertible_v<const T &, std::string_view>,
+                          "unsupported element type");
+            ZVAL_INTERNED_STR(&zv, intern(std::string_view{value}));
+        }
+        return zv;
+    }
+
+    HashTable *ht;
+};
+
+namespace zval_conversions {
+    inline zval_a to_zval(const immutable_array &arr) {
+        if (!arr) {
+            throw error_to{"the immutable_array has not been built"};
+        }
+        zval_a zv{arr.ht};
+        Z_TYPE_FLAGS(zv) = 0; // not refcounted: no addref/release
+        return zv;
+    }
+}
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <php.h>
+#include <type_traits>
 #include "strings.hpp"
 
 namespace zend {
@@ -88,5 +89,29 @@ struct BoolINIEntry : INIEntry<BoolINIEntry<S>> {
 };
 template<typename S>
 BoolINIEntry(const char *, const char *, INIPermission, S) -> BoolINIEntry<S>;
-}
 
+// accepts the usual size suffixes: 64K, 16M, 1G. The setter can return a
+// bool, false to reject the value
+template<typename S>
+struct LongINIEntry : INIEntry<LongINIEntry<S>> {
+    S setter;
+
+    LongINIEntry<S>(const char *name, const char *default_value,
+                    INIPermission p, S setter)
+        : INIEntry<LongINIEntry<S>>{name, default_value, p},
+          setter{setter} {}
+
+    bool on_modify(zend::zstring_view new_value, INIStage) {
+        zend_long value = zend_atol(new_value.data(), new_value.size());
+        if constexpr (std::is_same_v<std::invoke_result_t<S &, zend_long>,
+                                     bool>) {
+            return setter(value);
+        } else {
+            setter(value);
+            return true;
+        }
+    }
+};
+template<typename S>
+LongINIEntry(const char *, const char *, INIPermission, S) -> LongINIEntry<S>;
+}
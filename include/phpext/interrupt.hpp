@@ -0,0 +1,71 @@
+#pragma once
+#include <php.h>
+#include <cstdint>
+
+namespace zend {
+
+/* Thrown by check_interrupt() when the engine has an interrupt pending (the
+ * execution time limit was hit, a signal arrived, ...). It unwinds the
+ * native frames of the binding; the trampoline then catches it and lets the
+ * engine handle the interrupt as it would have between two opcodes */
+struct interrupted {};
+
+inline bool interrupt_pending() noexcept {
+    return EG(vm_interrupt);
+}
+
+inline void check_interrupt() {
+    if (UNEXPECTED(interrupt_pending())) {
+        throw interrupted{};
+    }
+}
+
+/* For hot loops: only looks at EG(vm_interrupt) once every `every` calls.
+ *
+ *    interrupt_poller poll;
+ *    for (auto &item : items) {
+ *        poll();
+ *        ...
+ *    }
+ */
+class interrupt_poller {
+public:
+    explicit interrupt_poller(uint32_t every = 1024) noexcept
+        : every{every}, countdown{every} {}
+
+    void operator()() {
+        if (UNEXPECTED(--countdown == 0)) {
+            countdown = every;
+            check_interrupt();
+        }
+    }
+
+private:
+    const uint32_t every;
+    uint32_t countdown;
+};
+
+namespace interrupt_detail {
+// same as the VM's interrupt helper. zend_timeout() bails out, so nothing
+// with a destructor may be live in the calling frame
+inline void handle_interrupt(zend_execute_data *execute_data) {
+    EG(vm_interrupt) = 0;
+    if (EG(timed_out)) {
+        zend_timeout(0);
+    } else if (zend_interrupt_function) {
+        zend_interrupt_function(execute_data);
+    }
+}
+} // namespace interrupt_detail
+
+// calls a binding so that an `interrupted` exception escaping it is turned
+// into the engine's own interrupt handling once the native frames are gone
+inline void interruptible(zif_handler body, INTERNAL_FUNCTION_PARAMETERS) {
+    try {
+        body(INTERNAL_FUNCTION_PARAM_PASSTHRU);
+        return;
+    } catch (const interrupted &) {
+    }
+    interrupt_detail::handle_interrupt(execute_data);
+}
+}
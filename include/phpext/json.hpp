@@ -0,0 +1,352 @@
+#pragma once
+#include <php.h>
+#include <Zend/zend_exceptions.h>
+#include <Zend/zend_smart_str.h>
+#include <ext/json/php_json.h>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "conversions.hpp"
+
+namespace zend {
+
+/* JSON written straight from native values, without building the PHP arrays
+ * json_encode() would need:
+ *
+ *    static zval_s user_json(long id) { return json::encode(load_user(id)); }
+ *
+ * Values can be booleans, integers, floats, strings (std::string,
+ * string_view, zstring_view, ...), nullptr, std::optional (null when empty),
+ * std::vector and std::array (JSON arrays) and reflected structs (JSON
+ * objects, see field()).
+ *
+ * The output is what json_encode() gives with JSON_UNESCAPED_SLASHES |
+ * JSON_UNESCAPED_UNICODE | JSON_INVALID_UTF8_SUBSTITUTE and the default
+ * serialize_precision (-1). Infinite and NaN floats can't be encoded: as
+ * with JSON_THROW_ON_ERROR, encode() throws a JsonException; encode_to()
+ * returns false, with 0 written in their place */
+namespace json {
+namespace detail {
+
+constexpr bool utf8_lead(unsigned char c) noexcept {
+    return c < 0x80 || (c >= 0xC2 && c <= 0xF4);
+}
+constexpr bool utf8_trail(unsigned char c) noexcept {
+    return c >= 0x80 && c <= 0xBF;
+}
+
+/* Length of the multibyte character at p, or, if it's invalid, of the bytes
+ * taken together as one invalid character: same rules as
+ * php_next_utf8_char(), so each gets one U+FFFD as with json_encode() */
+inline size_t utf8_seq_len(const char *p, const char *end,
+                           bool &valid) noexcept {
+    auto byte = [p](size_t i) { return static_cast<unsigned char>(p[i]); };
+    const auto avail = static_cast<size_t>(end - p);
+    const unsigned char c = byte(0);
+    valid = false;
+    if (c < 0xC2 || c > 0xF4) {
+        return 1;
+    }
+    const size_t len = c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+    for (size_t i = 1; i < len; i++) {
+        if (i < avail && utf8_trail(byte(i))) {
+            continue;
+        }
+        // the invalid prefix ends before the next byte that can start one
+        for (size_t j = 1; j < len; j++) {
+            if (j >= avail || utf8_lead(byte(j))) {
+                return j;
+            }
+        }
+        return len;
+    }
+    uint32_t cp = c & (0xFF >> (len + 1));
+    for (size_t i = 1; i < len; i++) {
+        cp = (cp << 6) | (byte(i) & 0x3F);
+    }
+    valid = !(len == 3 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) &&
+            !(len == 4 && (cp < 0x10000 || cp > 0x10FFFF));
+    return len;
+}
+
+// U+2028 and U+2029, escaped by json_encode() (they end lines in JS)
+inline bool is_line_terminator(const char *p, size_t len) noexcept {
+    return len == 3 && p[0] == '\xE2' && p[1] == '\x80' &&
+           (p[2] == '\xA8' || p[2] == '\xA9');
+}
+
+inline void append_escape(smart_str &out, unsigned char c) {
+    switch (c) {
+    case '"':
+        smart_str_appendl(&out, "\\\"", 2);
+        break;
+    case '\\':
+        smart_str_appendl(&out, "\\\\", 2);
+        break;
+    case '\b':
+        smart_str_appendl(&out, "\\b", 2);
+        break;
+    case '\f':
+        smart_str_appendl(&out, "\\f", 2);
+        break;
+    case '\n':
+        smart_str_appendl(&out, "\\n", 2);
+        break;
+    case '\r':
+        smart_str_appendl(&out, "\\r", 2);
+        break;
+    case '\t':
+        smart_str_appendl(&out, "\\t", 2);
+        break;
+    default: {
+        static constexpr char digits[] = "0123456789abcdef";
+        char esc[] = {'\\', 'u', '0', '0', digits[c >> 4], digits[c & 0xF]};
+        smart_str_appendl(&out, esc, sizeof esc);
+    }
+    }
+}
+
+/* Characters that need no escaping are copied in runs. With SSE2, 16 bytes
+ * are checked at a time; the scalar loop only handles the bytes that need
+ * escaping or UTF-8 validation */
+inline void append_string(smart_str &out, std::string_view str) {
+    const char *p = str.data();
+    const char *const end = p + str.size();
+    const char *run = p; // start of the bytes not yet copied
+    smart_str_appendc(&out, '"');
+    while (p < end) {
+#ifdef __SSE2__
+        if (end - p >= 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            // as signed bytes, both control chars and bytes >= 0x80 are < 0x20
+            __m128i special = _mm_or_si128(
+                    _mm_cmplt_epi8(v, _mm_set1_epi8(0x20)),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+            int mask = _mm_movemask_epi8(special);
+            if (mask == 0) {
+                p += 16;
+                continue;
+            }
+            p += __builtin_ctz(mask);
+        }
+#endif
+        auto c = static_cast<unsigned char>(*p);
+        if (c >= 0x80) {
+            bool valid;
+            size_t len = utf8_seq_len(p, end, valid);
+            if (valid && !is_line_terminator(p, len)) {
+                p += len;
+                continue;
+            }
+            smart_str_appendl(&out, run, p - run);
+            if (!valid) {
+                smart_str_appendl(&out, "\xEF\xBF\xBD", 3); // U+FFFD
+            } else if (p[2] == '\xA8') {
+                smart_str_appendl(&out, "\\u2028", 6);
+            } else {
+                smart_str_appendl(&out, "\\u2029", 6);
+            }
+            run = p += len;
+            continue;
+        } else if (c >= 0x20 && c != '"' && c != '\\') {
+            p++;
+            continue;
+        }
+        smart_str_appendl(&out, run, p - run);
+        append_escape(out, c);
+        run = ++p;
+    }
+    smart_str_appendl(&out, run, p - run);
+    smart_str_appendc(&out, '"');
+}
+
+template<typename I>
+inline void append_int(smart_str &out, I value) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof buf, value);
+    smart_str_appendl(&out, buf, res.ptr - buf);
+}
+
+/* as php_gcvt() with serialize_precision=-1: the shortest digits that read
+ * back the same, in fixed notation for decimal exponents from -4 to 16 and
+ * as 1.0e+25 otherwise. false (and 0 written) for infinities and NaN */
+inline bool append_double(smart_str &out, double value) {
+    if (!std::isfinite(value)) {
+        smart_str_appendc(&out, '0');
+        return false;
+    }
+    char sci[32]; // [-]d[.ddd]e(+|-)dd
+    const char *sci_end = std::to_chars(sci, sci + sizeof sci, value,
+                                        std::chars_format::scientific)
+                                  .ptr;
+    const char *p = sci;
+    char buf[40];
+    char *dst = buf;
+    if (*p == '-') {
+        *dst++ = *p++;
+    }
+    char digits[24];
+    int num_digits = 0;
+    for (; *p != 'e'; p++) {
+        if (*p != '.') {
+            digits[num_digits++] = *p;
+        }
+    }
+    int exp = 0;
+    std::from_chars(p + 2, sci_end, exp);
+    if (p[1] == '-') {
+        exp = -exp;
+    }
+
+    if (exp < -4 || exp > 16) {
+        *dst++ = digits[0];
+        *dst++ = '.';
+        if (num_digits == 1) {
+            *dst++ = '0';
+        } else {
+            dst = std::copy(digits + 1, digits + num_digits, dst);
+        }
+        *dst++ = 'e';
+        *dst++ = exp < 0 ? '-' : '+';
+        dst = std::to_chars(dst, buf + sizeof buf, exp < 0 ? -exp : exp).ptr;
+    } else if (exp < 0) {
+        *dst++ = '0';
+        *dst++ = '.';
+        dst = std::fill_n(dst, -exp - 1, '0');
+        dst = std::copy(digits, digits + num_digits, dst);
+    } else {
+        int int_digits = exp + 1;
+        for (int i = 0; i < int_digits; i++) {
+            *dst++ = i < num_digits ? digits[i] : '0';
+        }
+        if (num_digits > int_digits) {
+            *dst++ = '.';
+            dst = std::copy(digits + int_digits, digits + num_digits, dst);
+        }
+    }
+    smart_str_appendl(&out, buf, dst - buf);
+    return true;
+}
+
+// "key": for object members, built at compile time
+template<char... Cs>
+struct member_key {
+    static_assert(((Cs != '"' && Cs != '\\' &&
+                    static_cast<unsigned char>(Cs) >= 0x20) &&
+                   ...),
+                  "keys of reflected fields are not escaped");
+    static constexpr char chars[] = {'"', Cs..., '"', ':'};
+};
+
+template<typename T>
+struct is_json_array : std::false_type {};
+template<typename T, typename A>
+struct is_json_array<std::vector<T, A>> : std::true_type {};
+template<typename T, size_t N>
+struct is_json_array<std::array<T, N>> : std::true_type {};
+
+// false if some value couldn't be encoded
+template<typename T>
+bool write(smart_str &out, const T &value);
+
+template<typename S, auto member, char... Cs>
+bool write_member(smart_str &out, field_t<member, ct_string<char, Cs...>>,
+                  const S &s, bool &first) {
+    if (!first) {
+        smart_str_appendc(&out, ',');
+    }
+    first = false;
+    using key = member_key<Cs...>;
+    smart_str_appendl(&out, key::chars, sizeof key::chars);
+    return write(out, s.*member);
+}
+
+template<typename T>
+bool write(smart_str &out, const T &value) {
+    bool ok = true;
+    if constexpr (std::is_same_v<T, bool>) {
+        if (value) {
+            smart_str_appendl(&out, "true", 4);
+        } else {
+            smart_str_appendl(&out, "false", 5);
+        }
+    } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+        smart_str_appendl(&out, "null", 4);
+    } else if constexpr (std::is_integral_v<T>) {
+        append_int(out, value);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        ok = append_double(out, static_cast<double>(value));
+    } else if constexpr (is_optional_v<T>) {
+        if (value) {
+            ok = write(out, *value);
+        } else {
+            smart_str_appendl(&out, "null", 4);
+        }
+    } else if constexpr (is_reflected_v<T>) {
+        smart_str_appendc(&out, '{');
+        bool first = true;
+        std::apply(
+                [&](auto... fields) {
+                    ((ok &= write_member(out, fields, value, first)), ...);
+                },
+                T::fields);
+        smart_str_appendc(&out, '}');
+    } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+        append_string(out, std::string_view{value});
+    } else if constexpr (is_json_array<T>::value) {
+        smart_str_appendc(&out, '[');
+        bool first = true;
+        for (const auto &elem : value) {
+            if (!first) {
+                smart_str_appendc(&out, ',');
+            }
+            first = false;
+            ok &= write(out, elem);
+        }
+        smart_str_appendc(&out, ']');
+    } else {
+        static_assert(sizeof(T) == 0, "no JSON representation for type");
+    }
+    return ok;
+}
+
+/* ext/json's JsonException, looked up by name rather than through
+ * php_json_exception_ce: ext/json may be a shared module, loaded after this
+ * one or not at all (then Exception is thrown instead) */
+inline zend_class_entry *json_exception_ce() {
+    auto *ce = static_cast<zend_class_entry *>(zend_hash_str_find_ptr(
+            CG(class_table), "jsonexception", sizeof("jsonexception") - 1));
+    return ce ? ce : zend_ce_exception;
+}
+} // namespace detail
+
+/* appends to a buffer being built, e.g. to write several documents. false
+ * if an infinite or NaN float was found */
+template<typename T>
+inline bool encode_to(smart_str &out, const T &value) {
+    return detail::write(out, value);
+}
+
+template<typename T>
+inline zval_s encode(const T &value) {
+    smart_str out{};
+    if (!detail::write(out, value)) {
+        zend_throw_exception(detail::json_exception_ce(),
+                             "Inf and NaN cannot be JSON encoded",
+                             PHP_JSON_ERROR_INF_OR_NAN);
+    }
+    smart_str_0(&out);
+    return zval_s{out.s}; // never empty: the output has at least one char
+}
+} // namespace json
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include <php.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <ext/standard/info.h>
+#include "strings.hpp"
+#include "zmm.hpp"
+
+namespace zend {
+
+/* Process-wide LRU cache of native values, for sharing derived data between
+ * the request threads of a ZTS build (in NTS builds it's shared between the
+ * requests of one process).
+ *
+ * Keys are hashed to one of several shards, each with its own lock, LRU list
+ * and share of the byte budget. Values are handed out as shared_ptr<const V>,
+ * so an entry can be evicted while a request still uses it. All the memory is
+ * persistent: values must not hold request memory (zvals, zend_strings...).
+ *
+ * The cost of an entry is the size of its key plus what the caller says the
+ * value takes; the budget can be changed at any time, e.g. from an INI entry,
+ * rejecting negative values:
+ *
+ *    LongINIEntry{"myext.cache_size", "16M", INIPermission::SYSTEM,
+ *                 [](zend_long v) {
+ *                     if (v < 0) {
+ *                         return false;
+ *                     }
+ *                     cache.set_budget(static_cast<size_t>(v));
+ *                     return true;
+ *                 }}
+ */
+template<typename V>
+class lru_cache {
+public:
+    using value_ptr = std::shared_ptr<const V>;
+
+    struct stats_t {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t entries;
+        size_t bytes;
+    };
+
+    explicit lru_cache(size_t budget, size_t num_shards = 16)
+        : shards(num_shards) {
+        set_budget(budget);
+    }
+
+    lru_cache(const lru_cache &) = delete;
+    lru_cache &operator=(const lru_cache &) = delete;
+
+    void set_budget(size_t budget) {
+        size_t per_shard = budget / shards.size();
+        for (shard &s : shards) {
+            std::lock_guard<std::mutex> lock{s.mutex};
+            s.budget = per_shard;
+            s.evict_over_budget();
+        }
+    }
+
+    // nullptr on miss
+    value_ptr get(std::string_view key) {
+        shard &s = shard_for(key);
+        std::lock_guard<std::mutex> lock{s.mutex};
+        auto it = s.index.find(key);
+        if (it == s.index.end()) {
+            s.misses.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        s.hits.fetch_add(1, std::memory_order_relaxed);
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        return it->second->value;
+    }
+
+    // entries larger than a shard's budget are not kept
+    value_ptr put(std::string_view key, V value, size_t value_cost) {
+        value_ptr ptr = std::allocate_shared<V>(zmm::PersistentAllocator<V>{},
+                                                std::move(value));
+        shard &s = shard_for(key);
+        std::lock_guard<std::mutex> lock{s.mutex};
+        auto it = s.index.find(key);
+        if (it != s.index.end()) {
+            s.remove(it->second);
+        }
+        size_t cost = key.size() + value_cost;
+        if (cost > s.budget) {
+            return ptr;
+        }
+        s.lru.push_front(node{zmm::persistent_string{key}, ptr, cost});
+        s.index.emplace(s.lru.front().key, s.lru.begin());
+        s.bytes += cost;
+        s.evict_over_budget();
+        return ptr;
+    }
+
+    // make() runs without any lock held, so two threads missing the same
+    // key at the same time may both compute it
+    template<typename F>
+    value_ptr get_or_compute(std::string_view key, F make,
+                             size_t value_cost) {
+        if (value_ptr v = get(key)) {
+            return v;
+        }
+        return put(key, make(), value_cost);
+    }
+
+    stats_t stats() const {
+        stats_t st{};
+        for (const shard &s : shards) {
+            st.hits += s.hits.load(std::memory_order_relaxed);
+            st.misses += s.misses.load(std::memory_order_relaxed);
+            st.evictions += s.evictions.load(std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock{s.mutex};
+            st.entries += s.index.size();
+            st.bytes += s.bytes;
+        }
+        return st;
+    }
+
+    // rows for the extension's phpinfo() table
+    void print_info_rows(const char *prefix) const {
+        stats_t st = stats();
+        print_row(prefix, " hits", st.hits);
+        print_row(prefix, " misses", st.misses);
+        print_row(prefix, " evictions", st.evictions);
+        print_row(prefix, " entries", st.entries);
+        print_row(prefix, " bytes", st.bytes);
+    }
+
+private:
+    struct node {
+        zmm::persistent_string key;
+        value_ptr value;
+        size_t cost;
+    };
+    using lru_list = std::list<node, zmm::PersistentAllocator<node>>;
+    // the keys point into the nodes
+    using index_map = std::unordered_map<
+            std::string_view, typename lru_list::iterator,
+            std::hash<std::string_view>, std::equal_to<std::string_view>,
+            zmm::PersistentAllocator<std::pair<
+                    const std::string_view, typename lru_list::iterator>>>;
+
+    struct shard {
+        mutable std::mutex mutex;
+        lru_list lru; // most recently used first
+        index_map index;
+        size_t bytes = 0;
+        size_t budget = 0;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> evictions{0};
+
+        void remove(typename lru_list::iterator it) {
+            bytes -= it->cost;
+            index.erase(std::string_view{it->key});
+            lru.erase(it);
+        }
+
+        void evict_over_budget() {
+            while (bytes > budget && !lru.empty()) {
+                remove(std::prev(lru.end()));
+                evictions.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    shard &shard_for(std::string_view key) {
+        return shards[ze_hash(key.data(), key.size()) % shards.size()];
+    }
+
+    static void print_row(const char *prefix, const char *name,
+                          uint64_t value) {
+        zmm::string label{prefix};
+        label += name;
+        char buf[24];
+        snprintf(buf, sizeof buf, "%llu",
+                 static_cast<unsigned long long>(value));
+        php_info_print_table_row(2, label.c_str(), buf);
+    }
+
+    std::vector<shard, zmm::PersistentAllocator<shard>> shards;
+};
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <php.h>
+#include <cstring>
+#include <Zend/zend_smart_str.h>
+#include "request_table.hpp"
+
+namespace zend {
+
+/* Per-request cache for bindings registered with the memoize policy.
+ *
+ * The key is built from the raw argument zvals, before any conversion, so a
+ * hit costs one hash lookup and skips both the conversions and the native
+ * call. Only null, booleans, integers, floats and strings take part; calls
+ * with any other argument (arrays, objects, references) go straight through.
+ * Calls from strict_types code have keys of their own, so they don't get
+ * results computed from arguments they would have rejected.
+ * Calls that throw are not cached, and a returned object is shared by all
+ * the calls with the same arguments.
+ *
+ * The table lives in request memory and is emptied at the end of every
+ * request by PHPExtension */
+constexpr uint32_t memoize_max_entries = 4096;
+
+namespace memo_detail {
+inline thread_local request_table table{8};
+
+template<typename T>
+static void append_raw(smart_str &key, const T &value) {
+    smart_str_appendl(&key, reinterpret_cast<const char *>(&value),
+                      sizeof value);
+}
+
+// false if the arguments can't be part of a key
+static bool build_key(smart_str &key, zend_execute_data *execute_data) {
+    uint32_t num_args = ZEND_NUM_ARGS();
+    append_raw(key, EX(func));
+    append_raw(key, num_args);
+    // strict callers may reject what weak ones convert
+    smart_str_appendc(&key, ZEND_ARG_USES_STRICT_TYPES() ? 's' : 'w');
+    for (uint32_t i = 1; i <= num_args; i++) {
+        zval *arg = ZEND_CALL_ARG(execute_data, i);
+        char type = static_cast<char>(Z_TYPE_P(arg));
+        switch (Z_TYPE_P(arg)) {
+        case IS_NULL:
+        case IS_FALSE:
+        case IS_TRUE:
+            smart_str_appendc(&key, type);
+            break;
+        case IS_LONG:
+            smart_str_appendc(&key, type);
+            append_raw(key, Z_LVAL_P(arg));
+            break;
+        case IS_DOUBLE:
+            smart_str_appendc(&key, type);
+            append_raw(key, Z_DVAL_P(arg));
+            break;
+        case IS_STRING:
+            smart_str_appendc(&key, type);
+            append_raw(key, Z_STRLEN_P(arg));
+            smart_str_appendl(&key, Z_STRVAL_P(arg), Z_STRLEN_P(arg));
+            break;
+        default:
+            return false;
+        }
+    }
+    smart_str_0(&key);
+    return true;
+}
+
+static void call(zif_handler inner, INTERNAL_FUNCTION_PARAMETERS) {
+    smart_str key = {};
+    if (!build_key(key, execute_data)) {
+        smart_str_free(&key);
+        inner(INTERNAL_FUNCTION_PARAM_PASSTHRU);
+        return;
+    }
+
+    if (HashTable *cache = table.get()) {
+        zval *cached = zend_hash_find(cache, key.s);
+        if (cached) {
+            smart_str_free(&key);
+            ZVAL_COPY(return_value, cached);
+            return;
+        }
+    }
+
+    inner(INTERNAL_FUNCTION_PARAM_PASSTHRU);
+
+    if (!EG(exception) && !Z_ISUNDEF_P(return_value)) {
+        HashTable *cache = table.get_or_create();
+        if (zend_hash_num_elements(cache) < memoize_max_entries) {
+            zval copy;
+            ZVAL_COPY(&copy, return_value);
+            zend_hash_add_new(cache, key.s, &copy);
+        }
+    }
+    smart_str_free(&key);
+}
+} // namespace memo_detail
+
+// make is the function generating the non-memoized binding
+template<zif_handler (*make)()>
+static zif_handler wrap_memoized() {
+    static const zif_handler inner = make();
+    return [](INTERNAL_FUNCTION_PARAMETERS) -> void {
+        memo_detail::call(inner, INTERNAL_FUNCTION_PARAM_PASSTHRU);
+    };
+}
+}
@@ -0,0 +1,226 @@
+#pragma once
+#include <php.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "conversions.hpp"
+
+namespace zend {
+
+/* One PHP function for a set of C++ overloads:
+ *
+ *    reg_overloads<static_cast<std::string (*)(long)>(&describe),
+ *                  static_cast<std::string (*)(zstring_view)>(&describe)>(
+ *            "describe");
+ *
+ * The overload is chosen from the number of arguments and their types, by
+ * testing the type of each argument against the types each overload
+ * accepts, which are computed at compile time. The first overload taking
+ * the arguments without conversion is called. If there's none, the first
+ * one taking that number of arguments is called, and converts (or rejects)
+ * them as usual. Objects match a PHPClass parameter only if they're
+ * instances of its class.
+ *
+ * Positions taken by reference must be by reference in all the overloads
+ * having them. The arguments have no type hints */
+namespace overload_detail {
+constexpr size_t max_overload_args = 8;
+
+inline constexpr const char *arg_names[max_overload_args] = {
+        "arg1", "arg2", "arg3", "arg4", "arg5", "arg6", "arg7", "arg8"};
+
+constexpr uint32_t bit(zend_uchar type) {
+    return UINT32_C(1) << type;
+}
+
+using class_entry_getter = zend_class_entry *(*)();
+
+template<typename C>
+zend_class_entry *class_entry() noexcept {
+    return C::ce;
+}
+
+// the class objects must be instances of, for PHPClass parameters
+template<typename T>
+constexpr class_entry_getter class_getter() {
+    using B = std::remove_cv_t<
+            typename is_optional<std::remove_cv_t<T>>::base_type>;
+    if constexpr (std::is_reference_v<B> ||
+                  !std::is_same_v<remove_ref_wrapper_t<B>, B>) {
+        return class_getter<std::remove_cv_t<
+                remove_ref_wrapper_t<std::remove_reference_t<B>>>>();
+    } else if constexpr (std::is_class_v<B> &&
+                         std::is_base_of_v<PHPClass<B>, B>) {
+        return &class_entry<B>;
+    } else {
+        return nullptr;
+    }
+}
+
+// the zval types (of the dereferenced argument) taken without conversion
+template<typename T>
+constexpr uint32_t type_mask() {
+    using opt = is_optional<std::remove_cv_t<T>>;
+    using B = std::remove_cv_t<typename opt::base_type>;
+    constexpr uint32_t null_bit = opt::value ? bit(IS_NULL) : 0;
+    if constexpr (std::is_same_v<B, string_ref>) {
+        return bit(IS_STRING) | bit(IS_NULL) | bit(IS_UNDEF);
+    } else if constexpr (std::is_same_v<B, array_ref>) {
+        return bit(IS_ARRAY) | bit(IS_NULL) | bit(IS_UNDEF);
+    } else if constexpr (std::is_reference_v<B> ||
+                  !std::is_same_v<remove_ref_wrapper_t<B>, B>) {
+        // ref_arg: the referenced value can also be null
+        using R = std::remove_cv_t<
+                remove_ref_wrapper_t<std::remove_reference_t<B>>>;
+        if constexpr (class_getter<R>() != nullptr) {
+            return type_mask<R>() | null_bit; // objects, not ref_arg
+        } else {
+            return type_mask<R>() | bit(IS_NULL) | bit(IS_UNDEF) | null_bit;
+        }
+    } else if constexpr (std::is_same_v<B, bool>) {
+        return bit(IS_FALSE) | bit(IS_TRUE) | null_bit;
+    } else if constexpr (std::is_integral_v<B>) {
+        return bit(IS_LONG) | null_bit;
+    } else if constexpr (std::is_floating_point_v<B>) {
+        return bit(IS_DOUBLE) | null_bit;
+    } else if constexpr (std::is_same_v<B, zstring_view> ||
+                         std::is_same_v<B, std::string>) {
+        return bit(IS_STRING) | null_bit;
+    } else if constexpr (std::is_same_v<B, zval_mixed>) {
+        return ~UINT32_C(0);
+    } else if constexpr (is_reflected_v<B>) {
+        return bit(IS_ARRAY) | null_bit;
+    } else {
+        static_assert(std::is_class_v<B>, "unsupported parameter type");
+        return bit(IS_OBJECT) | null_bit;
+    }
+}
+
+struct candidate {
+    uint32_t min_args;
+    uint32_t max_args;
+    uint32_t by_ref; // bit i: argument i is taken by reference
+    std::array<uint32_t, max_overload_args> masks;
+    std::array<class_entry_getter, max_overload_args> classes;
+};
+
+template<typename FT, size_t... Is>
+constexpr candidate make_candidate(std::index_sequence<Is...>) {
+    using arg_traits = typename FT::arg_traits;
+    candidate c{static_cast<uint32_t>(arg_traits::min_args),
+                static_cast<uint32_t>(arg_traits::max_args), 0, {}, {}};
+    ((c.masks[Is] = type_mask<typename arg_traits::template elem_type<Is>>()),
+     ...);
+    ((c.classes[Is] =
+              class_getter<typename arg_traits::template elem_type<Is>>()),
+     ...);
+    ((c.by_ref |= arg_traits::template is_elem_ref_v<Is> && !c.classes[Is]
+                          ? 1u << Is
+                          : 0u),
+     ...);
+    return c;
+}
+
+template<typename FT>
+constexpr candidate make_candidate() {
+    static_assert(FT::arg_traits::max_args <= max_overload_args,
+                  "too many arguments");
+    static_assert(!FT::arg_traits::has_variadic,
+                  "overloads cannot be variadic");
+    return make_candidate<FT>(
+            std::make_index_sequence<FT::arg_traits::max_args>{});
+}
+
+template<typename... FTs>
+class overload_set {
+public:
+    static constexpr size_t size = sizeof...(FTs);
+    static constexpr candidate candidates[] = {make_candidate<FTs>()...};
+
+    static constexpr uint32_t min_args =
+            std::min({make_candidate<FTs>().min_args...});
+    static constexpr uint32_t max_args =
+            std::max({make_candidate<FTs>().max_args...});
+
+    static constexpr bool consistent_refs() {
+        for (const candidate &c : candidates) {
+            for (const candidate &d : candidates) {
+                uint32_t common = (UINT32_C(1) << std::min(c.max_args,
+                                                           d.max_args)) - 1;
+                if ((c.by_ref & common) != (d.by_ref & common)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    static_assert(consistent_refs(),
+                  "overloads must agree on which arguments are references");
+
+    static const zend_internal_arg_info *arginfo() {
+        static const auto info = []() {
+            std::array<zend_internal_arg_info, max_args + 1> arr{};
+            arr[0].name = reinterpret_cast<const char *>(
+                    static_cast<zend_uintptr_t>(min_args));
+            uint32_t by_ref = 0;
+            for (const candidate &c : candidates) {
+                by_ref |= c.by_ref;
+            }
+            for (uint32_t i = 0; i < max_args; i++) {
+                arr[i + 1].name = arg_names[i];
+                arr[i + 1].pass_by_reference = (by_ref >> i) & 1;
+            }
+            return arr;
+        }();
+        return info.data();
+    }
+
+    static void dispatch(const zif_handler (&handlers)[size],
+                         INTERNAL_FUNCTION_PARAMETERS) {
+        uint32_t num_args = ZEND_NUM_ARGS();
+        zval *args = ZEND_CALL_ARG(execute_data, 1);
+        size_t fallback = size;
+        for (size_t k = 0; k < size; k++) {
+            const candidate &c = candidates[k];
+            if (num_args < c.min_args || num_args > c.max_args) {
+                continue;
+            }
+            if (fallback == size) {
+                fallback = k;
+            }
+            if (matches(c, num_args, args)) {
+                handlers[k](INTERNAL_FUNCTION_PARAM_PASSTHRU);
+                return;
+            }
+        }
+        if (fallback != size) { // converts or fails with the usual errors
+            handlers[fallback](INTERNAL_FUNCTION_PARAM_PASSTHRU);
+        } else {
+            zend_wrong_parameters_count_exception(min_args, max_args);
+        }
+    }
+
+private:
+    static bool matches(const candidate &c, uint32_t num_args, zval *args) {
+        for (uint32_t i = 0; i < num_args; i++) {
+            zval *arg = &args[i];
+            ZVAL_DEREF(arg);
+            if (!(c.masks[i] & bit(Z_TYPE_P(arg)))) {
+                return false;
+            }
+            if (Z_TYPE_P(arg) == IS_OBJECT && c.classes[i] &&
+                    !instanceof_function(Z_OBJCE_P(arg), c.classes[i]())) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+} // namespace overload_detail
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <php.h>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "classes.hpp"
+
+namespace zend {
+
+enum class persistent_init { startup, first_use };
+
+/* Native object living outside request memory, from startup (or the first
+ * request needing it) until shutdown; e.g. a parsed schema or a loaded model.
+ * In ZTS builds it's shared by all the threads, so it must be safe to use
+ * concurrently.
+ *
+ * List it in the extension's `persistents` tuple and PHPExtension creates it
+ * at startup (for persistent_init::startup) and destroys it at shutdown.
+ * Expose it to PHP with a persistent_proxy */
+template<typename T>
+class persistent {
+public:
+    using factory_type = std::function<std::unique_ptr<T>()>;
+
+    explicit persistent(factory_type factory,
+                        persistent_init when = persistent_init::startup)
+        : factory{std::move(factory)}, when{when} {}
+
+    persistent(const persistent &) = delete;
+    persistent &operator=(const persistent &) = delete;
+
+    // exceptions from the factory are propagated
+    T &get() {
+        T *p = ptr.load(std::memory_order_acquire);
+        if (UNEXPECTED(!p)) {
+            p = load();
+        }
+        return *p;
+    }
+
+    bool loaded() const noexcept {
+        return ptr.load(std::memory_order_acquire) != nullptr;
+    }
+
+    /* hooks called by PHPExtension */
+    bool startup() noexcept {
+        if (when == persistent_init::first_use) {
+            return true;
+        }
+        try {
+            load();
+            return true;
+        } catch (const std::exception &e) {
+            zend_error(E_CORE_WARNING, "Failed to create persistent object: %s",
+                       e.what());
+        } catch (...) {
+            zend_error(E_CORE_WARNING, "Failed to create persistent object");
+        }
+        return false;
+    }
+
+    void shutdown() noexcept {
+        ptr.store(nullptr, std::memory_order_relaxed);
+        instance.reset();
+    }
+
+private:
+    T *load() {
+        std::lock_guard<std::mutex> lock{mutex};
+        T *p = ptr.load(std::memory_order_relaxed);
+        if (!p) {
+            instance = factory();
+            p = instance.get();
+            ptr.store(p, std::memory_order_release);
+        }
+        return p;
+    }
+
+    const factory_type factory;
+    const persistent_init when;
+    std::atomic<T *> ptr{nullptr};
+    std::unique_ptr<T> instance;
+    std::mutex mutex;
+};
+
+/* Request-scoped PHP object pointing to a persistent native object. Creating
+ * one only copies the pointer. C is the PHP class (CRTP, as with PHPClass):
+ *
+ *    class SchemaHandle : public persistent_proxy<SchemaHandle, Schema> {
+ *    public:
+ *        static constexpr auto php_class_name = "SchemaHandle"_cs;
+ *        using persistent_proxy::persistent_proxy;
+ *        static void register_php_methods() {
+ *            reg_instance_method<&SchemaHandle::validate>("validate");
+ *        }
+ *    private:
+ *        bool validate(zval_mixed v) { return target().validate(v); }
+ *    };
+ *
+ *    static SchemaHandle schema() { return SchemaHandle{schema_obj.get()}; }
+ *
+ * No PHP constructor is registered: the objects come from bindings only */
+template<typename C, typename T>
+class persistent_proxy : public PHPClass<C> {
+public:
+    explicit persistent_proxy(T &target) noexcept : ptr{&target} {}
+    persistent_proxy(const persistent_proxy &oth) noexcept
+        : PHPClass<C>{oth}, ptr{oth.ptr} {}
+
+protected:
+    T &target() const noexcept {
+        return *ptr;
+    }
+
+private:
+    T *ptr;
+};
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <type_traits>
+
+namespace zend {
+
+/* Tags passed after the name when registering a function or a static method
+ * to change how its binding is generated:
+ *
+ *    reg_function<&format_price>("format_price", zend::memoize);
+ */
+struct policy_tag {};
+
+// the function is pure: same arguments, same result, no side effects.
+// Results are cached for the rest of the request; see memoize.hpp
+struct memoize_t : policy_tag {};
+inline constexpr memoize_t memoize{};
+
+/* the binding shares a generic trampoline with the other compact ones
+ * instead of getting its own specialized handler: less code per binding, at
+ * the cost of a dispatch on each argument's type. See compact.hpp */
+struct compact_t : policy_tag {};
+inline constexpr compact_t compact{};
+
+// always a specialized handler, even with PHPEXT_COMPACT_BINDINGS
+struct hot_t : policy_tag {};
+inline constexpr hot_t hot{};
+
+template<typename P, typename... Policies>
+constexpr bool has_policy = (std::is_same_v<P, Policies> || ...);
+
+template<typename... Policies>
+constexpr bool are_policies = (std::is_base_of_v<policy_tag, Policies> && ...);
+}
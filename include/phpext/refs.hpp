@@ -0,0 +1,221 @@
+#pragma once
+#include <php.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include "conversions.hpp"
+
+namespace zend {
+
+/* By-reference parameters changed where they are, instead of converted to a
+ * native value and back (as with T&, which copies the value twice):
+ *
+ *    static void buffer_append(string_ref buf, zstring_view chunk) {
+ *        buf.append(chunk);
+ *    }
+ *
+ * The value is separated before the first change if it's shared with other
+ * variables. null (or an undefined variable) is taken as an empty string or
+ * array; other types are rejected.
+ *
+ * Only valid during the call */
+class string_ref {
+public:
+    explicit string_ref(zval *target) noexcept : zv{target} {}
+
+    zstring_view view() const noexcept {
+        return Z_STR_P(zv);
+    }
+    size_t size() const noexcept {
+        return Z_STRLEN_P(zv);
+    }
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // writable; the string is separated if shared
+    char *data() {
+        return ZSTR_VAL(reserve(size()));
+    }
+
+    /* Room is kept past the end of the string, growing geometrically, so
+     * appending in chunks takes amortized linear time */
+    void append(std::string_view str) {
+        // the source may be this string, which can move. Compared as
+        // integers: the pointers may be to unrelated objects
+        auto base = reinterpret_cast<uintptr_t>(Z_STRVAL_P(zv));
+        auto src_addr = reinterpret_cast<uintptr_t>(str.data());
+        size_t len = size();
+        bool aliased = src_addr >= base && src_addr < base + len;
+        zend_string *s = reserve(len + str.size());
+        const char *src = str.data();
+        if (aliased) {
+            src = ZSTR_VAL(s) + (src_addr - base);
+        }
+        memmove(ZSTR_VAL(s) + len, src, str.size());
+        set_length(s, len + str.size());
+    }
+
+    void append(char c) {
+        size_t len = size();
+        zend_string *s = reserve(len + 1);
+        ZSTR_VAL(s)[len] = c;
+        set_length(s, len + 1);
+    }
+
+    // new bytes are zeroed
+    void resize(size_t new_len) {
+        size_t len = size();
+        zend_string *s = reserve(new_len);
+        if (new_len > len) {
+            memset(ZSTR_VAL(s) + len, 0, new_len - len);
+        }
+        set_length(s, new_len);
+    }
+
+    void assign(std::string_view str) {
+        zend_string *s = zend_string_init(str.data(), str.size(), 0);
+        zval_ptr_dtor(zv);
+        ZVAL_NEW_STR(zv, s);
+    }
+
+private:
+    // the string, not shared and with room for len bytes
+    zend_string *reserve(size_t len) {
+        zend_string *s = Z_STR_P(zv);
+        size_t block_size = 0;
+        if (!ZSTR_IS_INTERNED(s) && GC_REFCOUNT(s) == 1) {
+            block_size = zend_mem_block_size(s);
+            if (_ZSTR_STRUCT_SIZE(len) <= block_size) {
+                zend_string_forget_hash_val(s);
+                return s;
+            }
+        }
+        size_t cur_len = ZSTR_LEN(s);
+        size_t capacity = std::max(len, cur_len);
+        // no spare room if the allocator can't tell the size of the blocks
+        if (len > cur_len && block_size != 0) {
+            capacity = std::max(len, cur_len + cur_len / 2);
+        }
+        s = zend_string_realloc(s, capacity, 0); // copies if shared
+        set_length(s, cur_len);
+        ZVAL_NEW_STR(zv, s);
+        return s;
+    }
+
+    static void set_length(zend_string *s, size_t len) noexcept {
+        ZSTR_LEN(s) = len;
+        ZSTR_VAL(s)[len] = '\0';
+    }
+
+    zval *zv;
+};
+
+class array_ref {
+public:
+    explicit array_ref(zval *target) noexcept : zv{target} {}
+
+    const HashTable *table() const noexcept {
+        return Z_ARRVAL_P(zv);
+    }
+    size_t size() const noexcept {
+        return zend_hash_num_elements(Z_ARRVAL_P(zv));
+    }
+
+    // nullptr if not found. Not to be modified
+    const zval *find(zend_long idx) const noexcept {
+        return zend_hash_index_find(Z_ARRVAL_P(zv), idx);
+    }
+    const zval *find(std::string_view key) const noexcept {
+        return zend_symtable_str_find(Z_ARRVAL_P(zv), key.data(), key.size());
+    }
+
+    // writable; the array is separated if shared
+    HashTable *mutable_table() {
+        SEPARATE_ARRAY(zv);
+        return Z_ARRVAL_P(zv);
+    }
+
+    // values are converted as return values
+    template<typename T>
+    void set(zend_long idx, T &&value) {
+        zval v = convert_to_zval(std::forward<T>(value));
+        zend_hash_index_update(mutable_table(), idx, &v);
+    }
+    template<typename T>
+    void set(std::string_view key, T &&value) {
+        zval v = convert_to_zval(std::forward<T>(value));
+        zend_symtable_str_update(mutable_table(), key.data(), key.size(), &v);
+    }
+
+    template<typename T>
+    void push(T &&value) {
+        zval v = convert_to_zval(std::forward<T>(value));
+        if (!zend_hash_next_index_insert(mutable_table(), &v)) {
+            zval_ptr_dtor(&v); // the next index would overflow
+        }
+    }
+
+    bool erase(zend_long idx) {
+        return zend_hash_index_del(mutable_table(), idx) == SUCCESS;
+    }
+    bool erase(std::string_view key) {
+        return zend_symtable_str_del(mutable_table(), key.data(),
+                                     key.size()) == SUCCESS;
+    }
+
+private:
+    friend zval_a zval_conversions::to_zval(const array_ref &);
+
+    zval *zv;
+};
+
+namespace zval_conversions {
+    // the referenced zval, made a string or array if it was null
+    inline zval *in_place_target(zval &zv, zend_uchar type,
+                                 zend_expected_type expected) {
+        if (Z_TYPE(zv) != IS_REFERENCE) {
+            throw error_from_no_ctx{ZPP_ERROR_NO_REFERENCE};
+        }
+        zval *target = Z_REFVAL(zv);
+        if (Z_TYPE_P(target) == IS_NULL || Z_TYPE_P(target) == IS_UNDEF) {
+            if (type == IS_STRING) {
+                ZVAL_EMPTY_STRING(target);
+            } else {
+                ZVAL_EMPTY_ARRAY(target);
+            }
+        } else if (Z_TYPE_P(target) != type) {
+            throw error_from_no_ctx{ZPP_ERROR_WRONG_ARG, expected, nullptr};
+        }
+        return target;
+    }
+
+    template<>
+    struct from_zval_c<string_ref> {
+        static string_ref from_zval(zval &zv) {
+            return string_ref{
+                    in_place_target(zv, IS_STRING, Z_EXPECTED_STRING)};
+        }
+    };
+
+    template<>
+    struct from_zval_c<array_ref> {
+        static array_ref from_zval(zval &zv) {
+            return array_ref{in_place_target(zv, IS_ARRAY, Z_EXPECTED_ARRAY)};
+        }
+    };
+
+    inline zval_s to_zval(const string_ref &ref) {
+        zval_s zv{zend_string_copy(ref.view())};
+        return zv;
+    }
+
+    inline zval_a to_zval(const array_ref &ref) {
+        zval_a zv{zval_a::uninit};
+        ZVAL_COPY(&zv, ref.zv);
+        return zv;
+    }
+}
+}
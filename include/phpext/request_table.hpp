@@ -0,0 +1,56 @@
+#pragma once
+#include <php.h>
+#include <cstdint>
+
+namespace zend {
+
+/* A HashTable in request memory, for per-request caches (memoize, the
+ * string pool). It's created on first use and destroyed, with all the other
+ * request tables in use, at the end of the request by PHPExtension:
+ *
+ *    inline thread_local request_table cache{64};
+ *
+ * A request runs on a single thread, so a thread_local table is per-request
+ * state. The values are destroyed with zval_ptr_dtor() */
+class request_table {
+public:
+    explicit constexpr request_table(uint32_t initial_size) noexcept
+        : initial_size{initial_size} {}
+
+    request_table(const request_table &) = delete;
+    request_table &operator=(const request_table &) = delete;
+
+    // nullptr if not used yet in this request
+    HashTable *get() const noexcept {
+        return table;
+    }
+
+    HashTable *get_or_create() {
+        if (!table) {
+            ALLOC_HASHTABLE(table);
+            zend_hash_init(table, initial_size, nullptr, ZVAL_PTR_DTOR, 0);
+            next = in_use;
+            in_use = this;
+        }
+        return table;
+    }
+
+    // called by PHPExtension at the end of the request
+    static void reset_all() noexcept {
+        for (request_table *t = in_use; t; t = t->next) {
+            zend_hash_destroy(t->table);
+            FREE_HASHTABLE(t->table);
+            t->table = nullptr;
+        }
+        in_use = nullptr;
+    }
+
+private:
+    // the tables created in this request, linked through next
+    static inline thread_local request_table *in_use = nullptr;
+
+    HashTable *table = nullptr;
+    request_table *next = nullptr;
+    const uint32_t initial_size;
+};
+}
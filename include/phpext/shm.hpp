@@ -0,0 +1,347 @@
+#pragma once
+#include <php.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "conversions.hpp"
+#include "strings.hpp"
+
+namespace zend {
+
+/* Key/value store in an anonymous MAP_SHARED mapping. Create it in the
+ * extension's startup, before the SAPI forks its workers (FPM, prefork
+ * Apache), and all the workers share a single copy.
+ *
+ * Open addressing with linear probing. Lookups take no locks; writers are
+ * serialized per key by a fixed set of process-shared mutexes. Entries are appended to an
+ * arena and never freed: replacing a value leaves the old one behind until
+ * the store is destroyed, and there is no removal. It's meant for tables
+ * written once at startup, or rarely, and read by every request.
+ *
+ * Values are null, booleans, integers, floats and strings. Strings are laid
+ * out as interned zend_strings, so reading one into a zval copies nothing */
+class shm_store {
+public:
+    shm_store(uint32_t max_entries, size_t arena_size)
+        : max_entries{max_entries} {
+        num_slots = 2;
+        while (num_slots < max_entries * 2) {
+            num_slots *= 2;
+        }
+        size_t slots_off = align(sizeof(header));
+        arena_off = align(slots_off + sizeof(slot) * num_slots);
+        map_size = arena_off + align(arena_size);
+
+        void *mem = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            throw std::system_error{errno, std::generic_category(),
+                                    "mmap of shared store"};
+        }
+        base = static_cast<char *>(mem);
+        hdr = new (base) header{};
+        hdr->arena_size = align(arena_size);
+        init_locks();
+        slots = reinterpret_cast<slot *>(base + slots_off);
+        for (uint32_t i = 0; i < num_slots; i++) {
+            new (&slots[i]) slot{};
+        }
+    }
+
+    shm_store(const shm_store &) = delete;
+    shm_store &operator=(const shm_store &) = delete;
+
+    ~shm_store() {
+        munmap(base, map_size);
+    }
+
+    // false if the value can't be stored or the store is full
+    bool set(std::string_view key, const zval &value) {
+        const zval *zv = &value;
+        ZVAL_DEREF(zv);
+        switch (Z_TYPE_P(zv)) {
+        case IS_NULL:
+        case IS_FALSE:
+        case IS_TRUE:
+            return insert(key, Z_TYPE_P(zv), {}, {});
+        case IS_LONG:
+            return insert(key, IS_LONG, {Z_LVAL_P(zv)}, {});
+        case IS_DOUBLE: {
+            number n;
+            n.dval = Z_DVAL_P(zv);
+            return insert(key, IS_DOUBLE, n, {});
+        }
+        case IS_STRING:
+            return insert(key, IS_STRING, {},
+                          {Z_STRVAL_P(zv), Z_STRLEN_P(zv)});
+        default:
+            return false;
+        }
+    }
+
+    template<typename T>
+    bool set(std::string_view key, const T &value) {
+        if constexpr (std::is_base_of_v<zval, T>) { // zval_mixed, ...
+            return set(key, static_cast<const zval &>(value));
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return insert(key, value ? IS_TRUE : IS_FALSE, {}, {});
+        } else if constexpr (std::is_integral_v<T>) {
+            return insert(key, IS_LONG, {static_cast<zend_long>(value)}, {});
+        } else if constexpr (std::is_floating_point_v<T>) {
+            number n;
+            n.dval = static_cast<double>(value);
+            return insert(key, IS_DOUBLE, n, {});
+        } else {
+            static_assert(std::is_convertible_v<T, std::string_view>,
+                          "unsupported value type");
+            return insert(key, IS_STRING, {}, std::string_view{value});
+        }
+    }
+
+    // the zval doesn't need to be destroyed
+    bool find(std::string_view key, zval *out) const {
+        const entry *e = lookup(key);
+        if (!e) {
+            return false;
+        }
+        switch (e->type) {
+        case IS_LONG:
+            ZVAL_LONG(out, e->num.lval);
+            break;
+        case IS_DOUBLE:
+            ZVAL_DOUBLE(out, e->num.dval);
+            break;
+        case IS_STRING:
+            ZVAL_INTERNED_STR(out, const_cast<zend_string *>(e->str()));
+            break;
+        default:
+            Z_TYPE_INFO_P(out) = e->type;
+        }
+        return true;
+    }
+
+    // for bindings: null if the key is not found
+    zval_mixed get(std::string_view key) const {
+        zval zv;
+        if (!find(key, &zv)) {
+            ZVAL_NULL(&zv);
+        }
+        return zval_mixed{zv};
+    }
+
+    uint32_t size() const noexcept {
+        return hdr->count.load(std::memory_order_relaxed);
+    }
+
+    size_t arena_used() const noexcept {
+        return hdr->arena_used.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t num_locks = 64;
+
+    union number {
+        zend_long lval;
+        double dval;
+    };
+
+    struct header {
+        std::atomic<uint32_t> count{0};
+        std::atomic<size_t> arena_used{0};
+        size_t arena_size = 0;
+        pthread_mutex_t locks[num_locks];
+    };
+
+    struct slot {
+        std::atomic<zend_ulong> hash{0}; // 0: free
+        std::atomic<size_t> entry{0};    // arena offset + 1; 0: being written
+    };
+
+    // followed by the key and, for strings, an interned zend_string
+    struct entry {
+        zend_ulong hash;
+        number num;
+        uint32_t key_len;
+        uint8_t type;
+
+        const char *key() const {
+            return reinterpret_cast<const char *>(this + 1);
+        }
+        static size_t str_off(size_t key_len) {
+            return align(sizeof(entry) + key_len);
+        }
+        const zend_string *str() const {
+            return reinterpret_cast<const zend_string *>(
+                    reinterpret_cast<const char *>(this) + str_off(key_len));
+        }
+    };
+
+    static constexpr size_t align(size_t n) {
+        return (n + 7) & ~static_cast<size_t>(7);
+    }
+
+    /* Robust, so a worker killed while writing (FPM's
+     * request_terminate_timeout) doesn't leave the lock held forever. What
+     * it leaves behind is harmless: at most a claimed slot without an entry,
+     * which readers skip, and unreferenced arena space */
+    void init_locks() {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        for (pthread_mutex_t &lock : hdr->locks) {
+            int err = pthread_mutex_init(&lock, &attr);
+            if (err) {
+                pthread_mutexattr_destroy(&attr);
+                munmap(base, map_size);
+                throw std::system_error{err, std::generic_category(),
+                                        "init of shared store lock"};
+            }
+        }
+        pthread_mutexattr_destroy(&attr);
+    }
+
+    class lock_guard {
+    public:
+        explicit lock_guard(pthread_mutex_t &lock) : lock{lock} {
+            if (pthread_mutex_lock(&lock) == EOWNERDEAD) {
+                pthread_mutex_consistent(&lock);
+            }
+        }
+        ~lock_guard() {
+            pthread_mutex_unlock(&lock);
+        }
+
+    private:
+        pthread_mutex_t &lock;
+    };
+
+    const entry *entry_at(size_t ref) const {
+        return reinterpret_cast<const entry *>(base + arena_off + ref - 1);
+    }
+
+    bool matches(const entry *e, std::string_view key) const {
+        return e->key_len == key.size() &&
+               std::memcmp(e->key(), key.data(), key.size()) == 0;
+    }
+
+    const entry *lookup(std::string_view key) const {
+        zend_ulong h = ze_hash(key.data(), key.size());
+        uint32_t mask = num_slots - 1;
+        for (uint32_t i = 0; i < num_slots; i++) {
+            const slot &s = slots[(h + i) & mask];
+            zend_ulong sh = s.hash.load(std::memory_order_acquire);
+            if (sh == 0) {
+                return nullptr;
+            }
+            if (sh != h) {
+                continue;
+            }
+            size_t ref = s.entry.load(std::memory_order_acquire);
+            if (ref && matches(entry_at(ref), key)) {
+                return entry_at(ref);
+            }
+        }
+        return nullptr;
+    }
+
+    // returns the reference to the new entry, or 0 if the arena is full
+    size_t allocate(zend_ulong h, std::string_view key, uint8_t type,
+                    number num, std::string_view str) {
+        size_t size = entry::str_off(key.size());
+        if (type == IS_STRING) {
+            size += align(_ZSTR_STRUCT_SIZE(str.size()));
+        }
+        size_t off = hdr->arena_used.load(std::memory_order_relaxed);
+        do {
+            if (off + size > hdr->arena_size) {
+                return 0;
+            }
+        } while (!hdr->arena_used.compare_exchange_weak(
+                off, off + size, std::memory_order_relaxed));
+
+        char *mem = base + arena_off + off;
+        new (mem) entry{h, num, static_cast<uint32_t>(key.size()), type};
+        std::memcpy(mem + sizeof(entry), key.data(), key.size());
+        if (type == IS_STRING) {
+            auto *zs = reinterpret_cast<zend_string *>(
+                    mem + entry::str_off(key.size()));
+            GC_SET_REFCOUNT(zs, 2);
+            GC_TYPE_INFO(zs) = IS_STRING | ((IS_STR_INTERNED |
+                                             IS_STR_PERSISTENT |
+                                             IS_STR_PERMANENT)
+                                            << GC_FLAGS_SHIFT);
+            ZSTR_LEN(zs) = str.size();
+            std::memcpy(ZSTR_VAL(zs), str.data(), str.size());
+            ZSTR_VAL(zs)[str.size()] = '\0';
+            // computed now, so readers never write to the shared memory
+            ZSTR_H(zs) = ze_hash(str.data(), str.size());
+        }
+        return off + 1;
+    }
+
+    bool insert(std::string_view key, uint8_t type, number num,
+                std::string_view str) {
+        zend_ulong h = ze_hash(key.data(), key.size());
+        uint32_t mask = num_slots - 1;
+        // writers of the same key always take the same lock, so there's no
+        // concurrent insertion of one key
+        lock_guard guard{hdr->locks[h % num_locks]};
+
+        // the entry is allocated once the key has a slot, so inserts
+        // rejected because the table is full don't use arena space
+        size_t ref = 0;
+        for (uint32_t i = 0; i < num_slots; i++) {
+            slot &s = slots[(h + i) & mask];
+            zend_ulong sh = s.hash.load(std::memory_order_acquire);
+            if (sh == h) {
+                size_t cur = s.entry.load(std::memory_order_acquire);
+                if (cur && matches(entry_at(cur), key)) {
+                    ref = allocate(h, key, type, num, str);
+                    if (!ref) {
+                        return false;
+                    }
+                    s.entry.store(ref, std::memory_order_release);
+                    return true;
+                }
+                continue;
+            }
+            if (sh != 0) {
+                continue;
+            }
+            // free slot; writers of other keys may race for it
+            if (hdr->count.load(std::memory_order_relaxed) >= max_entries) {
+                return false;
+            }
+            if (!ref) {
+                ref = allocate(h, key, type, num, str);
+                if (!ref) {
+                    return false;
+                }
+            }
+            if (!s.hash.compare_exchange_strong(sh, h,
+                                                std::memory_order_acq_rel)) {
+                continue; // taken by another key; try the next free slot
+            }
+            hdr->count.fetch_add(1, std::memory_order_relaxed);
+            s.entry.store(ref, std::memory_order_release);
+            return true;
+        }
+        return false;
+    }
+
+    const uint32_t max_entries;
+    uint32_t num_slots;
+    size_t arena_off;
+    size_t map_size;
+    char *base;
+    header *hdr;
+    slot *slots;
+};
+}
@@ -0,0 +1,239 @@
+#pragma once
+#include <php.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace zend {
+
+namespace snapshot_detail {
+// one per (thread, snapshot). Never freed: threads may outlive snapshots
+struct hazard_slot {
+    std::atomic<const void *> ptr{nullptr};
+    std::atomic<bool> in_use{false};
+    hazard_slot *next = nullptr;
+};
+
+struct thread_slots {
+    std::vector<hazard_slot *> by_snapshot;
+
+    ~thread_slots() {
+        for (hazard_slot *s : by_snapshot) {
+            if (s) {
+                s->ptr.store(nullptr, std::memory_order_release);
+                s->in_use.store(false, std::memory_order_release);
+            }
+        }
+    }
+};
+inline thread_local thread_slots tls_slots;
+inline std::atomic<size_t> next_snapshot_id{0};
+} // namespace snapshot_detail
+
+/* Immutable value rebuilt by a native background thread and read by the
+ * request threads without locking (read-copy-update). A request pins the
+ * current version when it starts and keeps seeing it until it ends, even
+ * if newer versions are published in the meantime. A version is destroyed
+ * once it's been replaced and no request has it pinned.
+ *
+ * The builder runs on the background thread: it must not use the Zend API.
+ * The thread is started by the first request of each process, not at
+ * startup: FPM and prefork Apache fork their workers after startup, and a
+ * fork while the thread holds one of the mutexes would leave the child's
+ * copy locked forever.
+ *
+ * List the snapshot in the extension's `snapshots` tuple to have
+ * PHPExtension drive startup, shutdown and the per-request pinning */
+template<typename T>
+class snapshot {
+public:
+    using builder_type = std::function<T()>;
+
+    snapshot(std::chrono::milliseconds interval, builder_type builder)
+        : interval{interval}, builder{std::move(builder)},
+          id{snapshot_detail::next_snapshot_id++} {}
+
+    snapshot(const snapshot &) = delete;
+    snapshot &operator=(const snapshot &) = delete;
+
+    ~snapshot() {
+        stop_refresher();
+        delete current.load(std::memory_order_relaxed);
+        for (const version *v : retired) {
+            delete v;
+        }
+    }
+
+    // the version pinned by the current request
+    const T &get() {
+        snapshot_detail::hazard_slot *s = slot();
+        auto *v = static_cast<const version *>(
+                s->ptr.load(std::memory_order_relaxed));
+        if (!v) {
+            v = pin(s);
+        }
+        return v->value;
+    }
+
+    void publish(T value) {
+        auto *v = new version{std::move(value)};
+        const version *old = current.exchange(v, std::memory_order_seq_cst);
+        if (old) {
+            std::lock_guard<std::mutex> lock{retired_mutex};
+            retired.push_back(old);
+            reclaim();
+        }
+    }
+
+    /* hooks called by PHPExtension */
+    void startup() {
+        publish(builder());
+    }
+
+    void shutdown() {
+        stop_refresher();
+    }
+
+    void request_start() {
+        pid_t pid = getpid();
+        pid_t started = refresher_pid.load(std::memory_order_acquire);
+        if (started != pid &&
+                refresher_pid.compare_exchange_strong(started, pid)) {
+            // first request of this process. If it was forked by a process
+            // that served requests, the thread stayed in the parent
+            (void) refresher.release();
+            start_refresher();
+        }
+        pin(slot());
+    }
+
+    void request_end() {
+        slot()->ptr.store(nullptr, std::memory_order_release);
+    }
+
+private:
+    struct version {
+        T value;
+    };
+
+    snapshot_detail::hazard_slot *slot() {
+        auto &slots = snapshot_detail::tls_slots.by_snapshot;
+        if (slots.size() <= id) {
+            slots.resize(id + 1);
+        }
+        if (!slots[id]) {
+            slots[id] = acquire_slot();
+        }
+        return slots[id];
+    }
+
+    snapshot_detail::hazard_slot *acquire_slot() {
+        using snapshot_detail::hazard_slot;
+        for (hazard_slot *s = slots_head.load(std::memory_order_acquire); s;
+             s = s->next) {
+            bool expected = false;
+            if (s->in_use.compare_exchange_strong(expected, true)) {
+                return s;
+            }
+        }
+        auto *s = new hazard_slot{};
+        s->in_use.store(true, std::memory_order_relaxed);
+        s->next = slots_head.load(std::memory_order_relaxed);
+        while (!slots_head.compare_exchange_weak(s->next, s,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
+        }
+        return s;
+    }
+
+    // hazard pointer protocol: the version is safe once it's been
+    // advertised in the slot and is still the current one afterwards
+    const version *pin(snapshot_detail::hazard_slot *s) {
+        const version *v = current.load(std::memory_order_acquire);
+        for (;;) {
+            s->ptr.store(v, std::memory_order_seq_cst);
+            const version *again = current.load(std::memory_order_seq_cst);
+            if (again == v) {
+                return v;
+            }
+            v = again;
+        }
+    }
+
+    // retired_mutex held
+    void reclaim() {
+        std::vector<const void *> in_use;
+        for (auto *s = slots_head.load(std::memory_order_acquire); s;
+             s = s->next) {
+            in_use.push_back(s->ptr.load(std::memory_order_seq_cst));
+        }
+        auto it = retired.begin();
+        while (it != retired.end()) {
+            if (std::find(in_use.begin(), in_use.end(), *it) ==
+                in_use.end()) {
+                delete *it;
+                it = retired.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void start_refresher() {
+        stopping = false;
+        refresher = std::make_unique<std::thread>([this]() {
+            std::unique_lock<std::mutex> lock{refresher_mutex};
+            for (;;) {
+                refresher_cv.wait_for(lock, interval,
+                                      [this]() { return stopping; });
+                if (stopping) {
+                    return;
+                }
+                lock.unlock();
+                try {
+                    publish(builder());
+                } catch (...) {
+                    // keep serving the previous version
+                }
+                lock.lock();
+            }
+        });
+    }
+
+    void stop_refresher() {
+        if (!refresher ||
+                refresher_pid.load(std::memory_order_acquire) != getpid()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock{refresher_mutex};
+            stopping = true;
+        }
+        refresher_cv.notify_all();
+        refresher->join();
+        refresher.reset();
+    }
+
+    const std::chrono::milliseconds interval;
+    const builder_type builder;
+    const size_t id;
+
+    std::atomic<const version *> current{nullptr};
+    std::atomic<snapshot_detail::hazard_slot *> slots_head{nullptr};
+    std::mutex retired_mutex;
+    std::vector<const version *> retired;
+
+    std::unique_ptr<std::thread> refresher;
+    std::atomic<pid_t> refresher_pid{0}; // the process that started it
+    std::mutex refresher_mutex;
+    std::condition_variable refresher_cv;
+    bool stopping = false;
+};
+}
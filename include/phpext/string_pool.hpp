@@ -0,0 +1,60 @@
+#pragma once
+#include <php.h>
+#include <string_view>
+#include "conversions.hpp"
+#include "request_table.hpp"
+
+namespace zend {
+
+/* Per-request pool of the strings returned through pooled_string. Returning
+ * the same content again hands out the string already in the pool, with its
+ * refcount incremented and its hash already computed, instead of a new
+ * allocation. Meant for small sets of repeated values: status codes, labels,
+ * column names...
+ *
+ * The pool lives in request memory and is emptied at the end of every request
+ * by PHPExtension. Past the limits, strings are allocated as usual */
+constexpr uint32_t string_pool_max_entries = 64 * 1024;
+constexpr size_t string_pool_max_length = 256;
+
+// the value is copied (or found in the pool) when converted to a zval
+struct pooled_string : std::string_view {
+    using std::string_view::string_view;
+    pooled_string(std::string_view str) noexcept : std::string_view{str} {}
+};
+
+namespace pool_detail {
+inline thread_local request_table table{64};
+} // namespace pool_detail
+
+// a new reference to the pooled string with this content
+inline zend_string *pooled(std::string_view str) {
+    if (str.size() > string_pool_max_length) {
+        return zend_string_init(str.data(), str.size(), 0);
+    }
+    HashTable *table = pool_detail::table.get_or_create();
+    if (zval *found = zend_hash_str_find(table, str.data(), str.size())) {
+        return zend_string_copy(Z_STR_P(found));
+    }
+
+    zend_string *zs = zend_string_init(str.data(), str.size(), 0);
+    if (zend_hash_num_elements(table) < string_pool_max_entries) {
+        zval zv;
+        ZVAL_STR_COPY(&zv, zs);
+        zend_hash_add_new(table, zs, &zv); // also caches the hash
+    }
+    return zs;
+}
+
+// the strings in the pool of this request
+inline uint32_t string_pool_size() noexcept {
+    HashTable *table = pool_detail::table.get();
+    return table ? zend_hash_num_elements(table) : 0;
+}
+
+namespace zval_conversions {
+    inline zval_s to_zval(pooled_string str) {
+        return zval_s{pooled(str)};
+    }
+}
+}
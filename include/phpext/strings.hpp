@@ -3,6 +3,8 @@
 #include <php.h>
 #include <utility>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace zend {
 
@@ -51,12 +53,13 @@ struct zend_string_static {
     char val[N];
 
     template<size_t... Is>
-    constexpr zend_string_static(const char (&c)[N], std::index_sequence<Is...>)
-        : gc{1, {IS_STRING | (IS_STR_PERSISTENT << GC_FLAGS_SHIFT)}},
+    constexpr zend_string_static(const char (&c)[N], uint32_t refcount,
+                                 std::index_sequence<Is...>)
+        : gc{refcount, {IS_STRING | (IS_STR_PERSISTENT << GC_FLAGS_SHIFT)}},
           h{ze_hash(c, N - 1)}, len{N - 1}, val{c[Is]...} {}
 
-    constexpr zend_string_static(const char (&c)[N])
-        : zend_string_static{c, std::make_index_sequence<N>()} {}
+    constexpr zend_string_static(const char (&c)[N], uint32_t refcount = 1)
+        : zend_string_static{c, refcount, std::make_index_sequence<N>()} {}
 
     constexpr operator zend_string *() {
         return reinterpret_cast<zend_string*>(this);
@@ -70,6 +73,59 @@ static_assert(
         "Objects of type zend_string_static cannot be created at compile time");
 
 
+/* "foo"_zs: interned zend_string with the hash computed at compile time.
+ *
+ * The strings live in static storage and are all added to the engine's
+ * permanent interned string table in one pass, when the extension starts
+ * (PHPExtension does it before calling startup()). Interning returns the
+ * engine's string if an equal one was interned before, so the pointer must
+ * be read after that: don't keep it in a static initialized at load time.
+ * ct_strings map to the same strings with zs() */
+namespace zs_detail {
+inline std::vector<zend_string **> &registry() {
+    static std::vector<zend_string **> slots;
+    return slots;
+}
+
+template<char... Cs>
+struct holder {
+    static constexpr char chars[] = {Cs..., 0};
+    // refcount 2: interning releases the string if it finds an equal one,
+    // and copies it if it has other references. This storage is never freed
+    static inline zend_string_static<sizeof...(Cs) + 1> storage{chars, 2};
+    static inline zend_string *ptr = storage;
+    static inline const bool registered = (registry().push_back(&ptr), true);
+};
+
+inline void intern_all() {
+    for (zend_string **slot : registry()) {
+        if (!ZSTR_IS_INTERNED(*slot)) {
+            *slot = zend_new_interned_string(*slot);
+        }
+    }
+}
+} // namespace zs_detail
+
+template<char... Cs>
+inline zend_string *zs(ct_string<char, Cs...>) {
+    using holder = zs_detail::holder<Cs...>;
+    static_cast<void>(holder::registered); // instantiate the registration
+    return holder::ptr;
+}
+
+#ifdef __clang__
+#   pragma clang diagnostic push
+#   pragma clang diagnostic ignored "-Wgnu-string-literal-operator-template"
+#endif
+template<typename Char, Char... Cs>
+inline zend_string *operator"" _zs() {
+    static_assert(std::is_same_v<Char, char>, "only narrow strings");
+    return zs(ct_string<char, Cs...>{});
+}
+#ifdef __clang__
+#   pragma clang diagnostic pop
+#endif
+
 struct zstring_view : std::string_view {
     zstring_view(zend_string *zstr) :
         std::string_view{ZSTR_VAL(zstr), ZSTR_LEN(zstr)} {}
@@ -0,0 +1,201 @@
+#pragma once
+#include <php.h>
+#include <Zend/zend_exceptions.h>
+#include <exception>
+#include <limits>
+#include <type_traits>
+#include "conversions.hpp"
+#include "interrupt.hpp"
+#include "worker_pool.hpp"
+#include "zmm.hpp"
+
+namespace zend {
+
+/* Bindings that apply a scalar function over every element of an array.
+ * The input is copied in bulk into a native buffer and the results are
+ * written straight into the buckets of a pre-sized packed array. Above
+ * vectorized_parallel_threshold elements the work is split across the
+ * worker_pool, so the scalar function must be safe to call concurrently and
+ * must not use the Zend API. If it throws, on any thread, the call throws an
+ * Exception with the message of the C++ exception and returns nothing */
+constexpr size_t vectorized_parallel_threshold = 64 * 1024;
+constexpr size_t vectorized_grain = 16 * 1024;
+
+inline const zend_internal_arg_info vectorized_arginfo[] = {
+        {reinterpret_cast<const char *>(static_cast<zend_uintptr_t>(1)),
+         ZEND_TYPE_ENCODE(IS_ARRAY, 0), 0, 0},
+        {"values", ZEND_TYPE_ENCODE(IS_ARRAY, 0), 0, 0},
+};
+
+namespace vectorized_detail {
+template<typename FT>
+struct scalar_traits {
+    using arg_traits = typename FT::arg_traits;
+    static_assert(arg_traits::max_args == 1 && arg_traits::min_args == 1,
+                  "vectorized functions take exactly one argument");
+    using in_type = std::decay_t<typename arg_traits::template elem_type<0>>;
+    using out_type = typename FT::ret_type;
+    static_assert(std::is_arithmetic_v<in_type>,
+                  "vectorized functions must take a number");
+    static_assert(std::is_arithmetic_v<out_type>,
+                  "vectorized functions must return a number or a boolean");
+};
+
+template<typename I>
+constexpr bool fits(zend_long value) {
+    if constexpr (std::is_signed_v<I>) {
+        return value >= std::numeric_limits<I>::min() &&
+               value <= std::numeric_limits<I>::max();
+    } else {
+        return value >= 0 && static_cast<zend_ulong>(value) <=
+                                     std::numeric_limits<I>::max();
+    }
+}
+
+/* Converts as the scalar binding would (strict_types, range checks); only
+ * the exact types skip the conversion. Returns the ZPP error code */
+template<typename In, typename S /* storage for In */>
+static int element_from_zval(zval *zv, S &out) {
+    ZVAL_DEREF(zv);
+    if constexpr (std::is_same_v<In, zend_long>) {
+        if (EXPECTED(Z_TYPE_P(zv) == IS_LONG)) {
+            out = Z_LVAL_P(zv);
+            return ZPP_ERROR_OK;
+        }
+    } else if constexpr (std::is_floating_point_v<In>) {
+        if (EXPECTED(Z_TYPE_P(zv) == IS_DOUBLE)) {
+            out = static_cast<S>(Z_DVAL_P(zv));
+            return ZPP_ERROR_OK;
+        }
+    }
+    try { // numeric strings, booleans, ...
+        if constexpr (std::is_same_v<In, bool>) {
+            out = zval_conversions::from_zval<bool>(*zv);
+        } else if constexpr (std::is_floating_point_v<In>) {
+            out = static_cast<S>(zval_conversions::from_zval<double>(*zv));
+        } else {
+            long value = zval_conversions::from_zval<long>(*zv);
+            if (!fits<In>(value)) {
+                return ZPP_ERROR_OVERFLOW;
+            }
+            out = static_cast<S>(value);
+        }
+        return ZPP_ERROR_OK;
+    } catch (const zval_conversions::error_from_no_ctx &err) {
+        return err.error_code;
+    }
+}
+
+// plain stores into preallocated memory; safe from the worker threads
+template<typename Out>
+static void set_bucket(Bucket *b, zend_ulong idx, Out value) noexcept {
+    if constexpr (std::is_same_v<Out, bool>) {
+        ZVAL_BOOL(&b->val, value);
+    } else if constexpr (std::is_integral_v<Out>) {
+        ZVAL_LONG(&b->val, static_cast<zend_long>(value));
+    } else {
+        ZVAL_DOUBLE(&b->val, static_cast<double>(value));
+    }
+    b->h = idx;
+    b->key = nullptr;
+}
+} // namespace vectorized_detail
+
+template<typename FT, typename FT::func_type func>
+static inline zif_handler wrap_vectorized_function() {
+    static constexpr zif_handler body = [](INTERNAL_FUNCTION_PARAMETERS) {
+        using traits = vectorized_detail::scalar_traits<FT>;
+        using in_type = typename traits::in_type;
+        using out_type = typename traits::out_type;
+
+        if (ZEND_NUM_ARGS() != 1) {
+            zend_wrong_parameters_count_exception(1, 1);
+            return;
+        }
+        zval *arr = ZEND_CALL_ARG(execute_data, 1);
+        ZVAL_DEREF(arr);
+        if (Z_TYPE_P(arr) != IS_ARRAY) {
+            zend_wrong_parameter_type_exception(1, Z_EXPECTED_ARRAY, arr);
+            return;
+        }
+
+        HashTable *ht = Z_ARRVAL_P(arr);
+        uint32_t n = zend_hash_num_elements(ht);
+        // avoid the std::vector<bool> specialization
+        using storage_type = std::conditional_t<std::is_same_v<in_type, bool>,
+                                                unsigned char, in_type>;
+        zmm::vector<storage_type> input(n);
+        {
+            uint32_t i = 0;
+            zval *elem;
+            interrupt_poller poll;
+            ZEND_HASH_FOREACH_VAL(ht, elem) {
+                poll();
+                int error = vectorized_detail::element_from_zval<in_type>(
+                        elem, input[i]);
+                if (error != ZPP_ERROR_OK) {
+                    const char *space, *class_name;
+                    class_name = get_active_class_name(&space);
+                    if (error == ZPP_ERROR_OVERFLOW) {
+                        zend_internal_type_error(
+                                1,
+                                "%s%s%s() expects an array of numbers, but "
+                                "the element at position %u is not within "
+                                "the accepted bounds",
+                                class_name, space, get_active_function_name(),
+                                i);
+                    } else {
+                        zend_internal_type_error(
+                                1,
+                                "%s%s%s() expects an array of numbers, but "
+                                "the element at position %u is of type %s",
+                                class_name, space, get_active_function_name(),
+                                i, zend_zval_type_name(elem));
+                    }
+                    return;
+                }
+                i++;
+            } ZEND_HASH_FOREACH_END();
+        }
+
+        array_init_size(return_value, n);
+        HashTable *out = Z_ARRVAL_P(return_value);
+        zend_hash_real_init_packed(out);
+        Bucket *buckets = out->arData;
+
+        auto apply = [&input, buckets](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                vectorized_detail::set_bucket<out_type>(
+                        &buckets[i], i,
+                        func(static_cast<in_type>(input[i])));
+            }
+        };
+        if (n >= vectorized_parallel_threshold) {
+            worker_pool::instance().parallel_for(n, vectorized_grain, apply);
+        } else {
+            apply(0, n);
+        }
+
+        out->nNumUsed = n;
+        out->nNumOfElements = n;
+        out->nNextFreeElement = n;
+        out->nInternalPointer = 0;
+    };
+    return [](INTERNAL_FUNCTION_PARAMETERS) -> void {
+        // must not propagate through the engine's C frames
+        try {
+            interruptible(body, INTERNAL_FUNCTION_PARAM_PASSTHRU);
+            return;
+        } catch (const std::exception &e) {
+            zend_throw_exception_ex(zend_ce_exception, 0,
+                                    "Native function failed: %s", e.what());
+        } catch (...) {
+            zend_throw_exception_ex(zend_ce_exception, 0,
+                                    "Native function failed");
+        }
+        // the buckets written so far are not counted in the array
+        zval_ptr_dtor(return_value);
+        ZVAL_NULL(return_value);
+    };
+}
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include <php.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+
+namespace zend {
+
+/* Process-wide pool of native threads. Jobs run outside of any request: they
+ * must not call the Zend API nor allocate with emalloc. The threads are
+ * started on first use, so that forking SAPIs (FPM, prefork) get one pool per
+ * worker process instead of a pool stranded in the master */
+class worker_pool {
+public:
+    using job = std::function<void()>;
+
+    static worker_pool &instance() {
+        static worker_pool pool;
+        return pool;
+    }
+
+    // to be called before the first submit; 0 means hardware concurrency
+    void configure(size_t num_threads) {
+        std::lock_guard<std::mutex> lock{mutex};
+        requested_threads = num_threads;
+    }
+
+    void submit(job j) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            ensure_started();
+            jobs.push_back(std::move(j));
+        }
+        cv.notify_one();
+    }
+
+    /* Runs body(begin, end) over [0, n) in chunks of grain elements. Chunks
+     * are claimed from a shared counter, so threads that finish early keep
+     * taking work that would otherwise wait behind a slow one. The calling
+     * thread takes chunks too and returns once all of them are done. The
+     * first exception thrown by body is rethrown here */
+    template<typename F>
+    void parallel_for(size_t n, size_t grain, F &&body) {
+        grain = std::max<size_t>(grain, 1);
+        size_t num_chunks = (n + grain - 1) / grain;
+        if (num_chunks <= 1) {
+            if (n > 0) {
+                body(size_t{0}, n);
+            }
+            return;
+        }
+
+        struct control {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            size_t n, grain, num_chunks;
+            std::remove_reference_t<F> *body; // valid while chunks remain
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::exception_ptr error;
+
+            void work() noexcept {
+                for (;;) {
+                    size_t chunk = next.fetch_add(1, std::memory_order_relaxed);
+                    if (chunk >= num_chunks) {
+                        return;
+                    }
+                    size_t begin = chunk * grain;
+                    try {
+                        (*body)(begin, std::min(begin + grain, n));
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock{mutex};
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                    if (done.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+                        num_chunks) {
+                        std::lock_guard<std::mutex> lock{mutex};
+                        cv.notify_all();
+                    }
+                }
+            }
+        };
+        auto ctl = std::make_shared<control>();
+        ctl->n = n;
+        ctl->grain = grain;
+        ctl->num_chunks = num_chunks;
+        ctl->body = &body;
+
+        size_t helpers = std::min(num_threads(), num_chunks - 1);
+        for (size_t i = 0; i < helpers; i++) {
+            submit([ctl]() { ctl->work(); });
+        }
+        ctl->work();
+        {
+            std::unique_lock<std::mutex> lock{ctl->mutex};
+            ctl->cv.wait(lock, [&]() {
+                return ctl->done.load(std::memory_order_acquire) == num_chunks;
+            });
+        }
+        if (ctl->error) {
+            std::rethrow_exception(ctl->error);
+        }
+    }
+
+    size_t num_threads() {
+        std::lock_guard<std::mutex> lock{mutex};
+        ensure_started();
+        return threads->size();
+    }
+
+    // joins the threads; pending jobs are discarded. Call on MSHUTDOWN
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (!threads || owner_pid != getpid()) {
+                return;
+            }
+            stopping = true;
+            jobs.clear();
+        }
+        cv.notify_all();
+        for (auto &t : *threads) {
+            t.join();
+        }
+        std::lock_guard<std::mutex> lock{mutex};
+        threads.reset();
+        stopping = false;
+    }
+
+    worker_pool(const worker_pool &) = delete;
+    worker_pool &operator=(const worker_pool &) = delete;
+
+    ~worker_pool() {
+        shutdown();
+        if (threads) { // inherited through fork: the threads don't exist here
+            (void) threads.release();
+        }
+    }
+
+private:
+    worker_pool() = default;
+
+    void ensure_started() {
+        pid_t pid = getpid();
+        if (threads && owner_pid == pid) {
+            return;
+        }
+        if (threads) {
+            // we're in a forked child; the std::thread objects refer to
+            // threads of the parent and can be neither joined nor destroyed
+            (void) threads.release();
+        }
+        owner_pid = pid;
+        size_t n = requested_threads;
+        if (n == 0) {
+            n = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::make_unique<std::vector<std::thread>>();
+        threads->reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            threads->emplace_back([this]() { run(); });
+        }
+    }
+
+    void run() noexcept {
+        for (;;) {
+            job j;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping) {
+                    return;
+                }
+                j = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            j();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<job> jobs;
+    std::unique_ptr<std::vector<std::thread>> threads;
+    size_t requested_threads = 0;
+    pid_t owner_pid = 0;
+    bool stopping = false;
+};
+}
@@ -11,7 +11,9 @@ template<typename T>
 struct ZendMMAllocator {
     using value_type = T;
 
-    T *allocate(size_t num) { return static_cast<T *>(emalloc(num)); }
+    T *allocate(size_t num) {
+        return static_cast<T *>(safe_emalloc(num, sizeof(T), 0));
+    }
     T *allocate(size_t num, [[maybe_unused]] const void *hint) {
         return static_cast<T *>(allocate(num));
     }
@@ -28,9 +30,44 @@ struct ZendMMAllocator {
     ZendMMAllocator &operator=(ZendMMAllocator &&) = default;
 };
 
+// for memory that outlives requests and may be shared between threads
+template<typename T>
+struct PersistentAllocator {
+    using value_type = T;
+
+    T *allocate(size_t num) {
+        return static_cast<T *>(safe_pemalloc(num, sizeof(T), 0, 1));
+    }
+    T *allocate(size_t num, [[maybe_unused]] const void *hint) {
+        return static_cast<T *>(allocate(num));
+    }
+    void deallocate(T *ptr, [[maybe_unused]] size_t num) {
+        if (ptr) {
+            pefree(static_cast<void *>(ptr), 1);
+        }
+    }
+
+    PersistentAllocator() = default;
+    template<typename U>
+    PersistentAllocator(const PersistentAllocator<U> &) noexcept {}
+};
+template<typename T, typename U>
+bool operator==(const PersistentAllocator<T> &, const PersistentAllocator<U> &) {
+    return true;
+}
+template<typename T, typename U>
+bool operator!=(const PersistentAllocator<T> &, const PersistentAllocator<U> &) {
+    return false;
+}
+
 template<typename T>
 using vector = std::vector<T, ZendMMAllocator<T>>;
 using string =
         std::basic_string<char, std::char_traits<char>, ZendMMAllocator<char>>;
+
+template<typename T>
+using persistent_vector = std::vector<T, PersistentAllocator<T>>;
+using persistent_string = std::basic_string<char, std::char_traits<char>,
+                                            PersistentAllocator<char>>;
 } // namespace zmm
 }
@@ -0,0 +1,33 @@
+<?php
+// Call throughput of a few bindings; see run.sh
+$n = (int) ($argv[1] ?? 2000000);
+
+$cases = [
+    'sum_ints' => function () use ($n) {
+        for ($i = 0; $i < $n; $i++) {
+            sum_ints($i & 0xFFFF, 7);
+        }
+    },
+    'celsius_to_fahrenheit' => function () use ($n) {
+        for ($i = 0; $i < $n; $i++) {
+            celsius_to_fahrenheit($i * 0.5);
+        }
+    },
+    'scaled (always compact)' => function () use ($n) {
+        for ($i = 0; $i < $n; $i++) {
+            scaled($i & 0xFFFF, 1.5);
+        }
+    },
+    'clamp_byte (hot)' => function () use ($n) {
+        for ($i = 0; $i < $n; $i++) {
+            clamp_byte($i);
+        }
+    },
+];
+
+foreach ($cases as $name => $case) {
+    $start = hrtime(true);
+    $case();
+    $ns = (hrtime(true) - $start) / $n;
+    printf("%-26s %6.1f ns/call\n", $name, $ns);
+}
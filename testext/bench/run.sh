@@ -0,0 +1,38 @@
+#!/bin/sh
+# Builds testext with specialized and with compact bindings
+# (PHPEXT_COMPACT_BINDINGS) and compares the size of the code and the time
+# per call. Needs phpize and php-config in the PATH, or PHPIZE, PHP_CONFIG
+# and PHP set.
+#
+#    testext/bench/run.sh [iterations]
+set -e
+
+PHPIZE=${PHPIZE:-phpize}
+PHP_CONFIG=${PHP_CONFIG:-php-config}
+PHP=${PHP:-php}
+bench_dir=$(cd "$(dirname "$0")" && pwd)
+build_dir=$(mktemp -d)
+trap 'rm -rf "$build_dir"' EXIT
+
+for mode in specialized compact; do
+    flags=""
+    if [ "$mode" = compact ]; then
+        flags="-DPHPEXT_COMPACT_BINDINGS"
+    fi
+    rm -rf "$build_dir/$mode"
+    mkdir "$build_dir/$mode"
+    cp "$bench_dir/../config.m4" "$bench_dir"/../*.cpp \
+        "$bench_dir"/../*.hpp "$build_dir/$mode"
+    (
+        cd "$build_dir/$mode"
+        sed -i "s|../include|$bench_dir/../../include|" config.m4
+        "$PHPIZE" >/dev/null
+        ./configure --with-php-config="$PHP_CONFIG" \
+            CXXFLAGS="-O2 $flags" >/dev/null
+        make -j"$(nproc)" >/dev/null
+    )
+    so="$build_dir/$mode/modules/testext.so"
+    echo "== $mode"
+    size -A "$so" | awk '$1 == ".text" { print ".text bytes:", $2 }'
+    "$PHP" -n -d extension="$so" "$bench_dir/calls.php" "$@"
+done
@@ -141,8 +141,33 @@ private:
     }
 };
 
+// methods registered on first use
+class LazyCounter : public zend::PHPClass<LazyCounter> {
+public:
+    constexpr static auto php_class_name = "LazyCounter"_cs;
+
+    LazyCounter(long n) : n{n} {}
+
+    static void register_php_methods() {
+        reg_constructor<arg_types<long>>();
+        reg_instance_method<&LazyCounter::next>("next");
+        reg_static_method<&LazyCounter::startingAt>("startingAt");
+    }
+private:
+    long n;
+
+    long next() {
+        return ++n;
+    }
+
+    static LazyCounter startingAt(long n) {
+        return {n};
+    }
+};
+
 void register_classes() {
     ClassNoMoveNoCopy::register_class();
     ClassMoveNoCopy::register_class();
     ClassNoMoveCopy::register_class();
+    LazyCounter::register_class_lazily();
 }
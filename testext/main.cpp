@@ -1,8 +1,11 @@
 #include <phpext.hpp>
+#include <phpext/async.hpp>
 #include <phpext/output.hpp>
+#include <stdexcept>
 #include "classes.hpp"
 
 using zend::operator""_cs;
+using zend::operator""_zs;
 
 class MyClass : public zend::PHPClass<MyClass> {
 public:
@@ -81,6 +84,112 @@ private:
     long x;
 };
 
+// loaded once per process, on first use
+struct WordList {
+    static inline std::atomic<int> loads{0};
+    std::vector<std::string> words;
+
+    WordList() : words{"apple", "apricot", "banana", "blueberry", "cherry"} {
+        loads++;
+    }
+    long count_prefix(std::string_view prefix) const {
+        long n = 0;
+        for (const auto &w : words) {
+            n += w.compare(0, prefix.size(), prefix) == 0;
+        }
+        return n;
+    }
+};
+
+class WordIndex : public zend::persistent_proxy<WordIndex, WordList> {
+public:
+    static constexpr auto php_class_name = "WordIndex"_cs;
+    using persistent_proxy::persistent_proxy;
+
+    static void register_php_methods() {
+        reg_class_constant("DEFAULT_PREFIX", "ap"_cs);
+        reg_class_constant("SORTED", true);
+    }
+
+private:
+    long countPrefix(zend::zstring_view prefix) {
+        return target().count_prefix(prefix);
+    }
+
+public:
+    static constexpr auto method_defs = std::tuple{
+            zend::def_method<&WordIndex::countPrefix>("countPrefix")};
+};
+
+// converted from/to PHP arrays
+struct server_config {
+    std::string host;
+    long port;
+    std::optional<double> timeout;
+
+    static constexpr auto fields = std::tuple{
+            zend::field<&server_config::host>("host"_cs),
+            zend::field<&server_config::port>("port"_cs),
+            zend::field<&server_config::timeout>("timeout"_cs)};
+};
+
+struct shape_stats {
+    long scalars = 0;
+    long containers = 0;
+    long max_depth = 0;
+    bool recursive = false;
+
+    static constexpr auto fields = std::tuple{
+            zend::field<&shape_stats::scalars>("scalars"_cs),
+            zend::field<&shape_stats::containers>("containers"_cs),
+            zend::field<&shape_stats::max_depth>("max_depth"_cs),
+            zend::field<&shape_stats::recursive>("recursive"_cs)};
+};
+
+// counts what zend::visit() walks through
+struct shape_visitor : zend::zval_visitor {
+    shape_stats stats;
+    long depth = 0;
+
+    bool on_null() { return scalar(); }
+    bool on_bool(bool) { return scalar(); }
+    bool on_long(zend_long) { return scalar(); }
+    bool on_double(double) { return scalar(); }
+    bool on_string(zend::zstring_view) { return scalar(); }
+    bool begin_array(const HashTable *) { return begin(); }
+    bool end_array() { return end(); }
+    bool begin_object(const zend_object *) { return begin(); }
+    bool end_object() { return end(); }
+    bool on_recursion(const zval &) {
+        stats.recursive = true;
+        return true;
+    }
+
+private:
+    bool scalar() {
+        stats.scalars++;
+        return true;
+    }
+    bool begin() {
+        stats.containers++;
+        stats.max_depth = std::max(stats.max_depth, ++depth);
+        return true;
+    }
+    bool end() {
+        depth--;
+        return true;
+    }
+};
+
+struct deployment {
+    std::string name;
+    server_config server;
+
+    static constexpr auto fields = std::tuple{
+            zend::field<&deployment::name>("name"_cs),
+            zend::field<&deployment::server>("server"_cs)};
+};
+
 namespace zend {
 
 
@@ -216,6 +325,243 @@ namespace global_funcs {
         if (!i) { return; }
         i->get()++;
     }
+    static double scale_score(double x) {
+        return x * 2 + 1;
+    }
+    static int halve(int x) {
+        return x / 2;
+    }
+    static double reciprocal(double x) {
+        if (x == 0) {
+            throw std::domain_error{"reciprocal of zero"};
+        }
+        return 1 / x;
+    }
+    static zend::Future async_sum_squares(long n) {
+        return zend::Future::submit([n]() {
+            long sum = 0;
+            for (long i = 0; i < n; i++) {
+                sum += i * i;
+            }
+            return sum;
+        });
+    }
+
+    // bumped by the refresher thread every 50ms
+    static std::atomic<long> builds{0};
+    static zend::snapshot<long> generation{std::chrono::milliseconds{50},
+                                           []() { return ++builds; }};
+    static long snapshot_generation() {
+        return generation.get();
+    }
+    // the version a new request would see; pinned for the rest of this one
+    static long snapshot_repinned_generation() {
+        generation.request_end();
+        generation.request_start();
+        return generation.get();
+    }
+
+    static long square_calls = 0;
+    static long counted_square(long x) {
+        square_calls++;
+        return x * x;
+    }
+    static long counted_square_calls() {
+        return square_calls;
+    }
+
+    // created at startup, shared with forked workers
+    static std::optional<zend::shm_store> shared_store;
+    static bool shared_set(zend::zstring_view key, zend::zval_mixed value) {
+        return shared_store->set(key, value);
+    }
+    static zend::zval_mixed shared_get(zend::zstring_view key) {
+        return shared_store->get(key);
+    }
+    // room for two entries, to test a full store
+    static std::optional<zend::shm_store> tiny_store;
+    static bool tiny_set(zend::zstring_view key, long value) {
+        return tiny_store->set(key, value);
+    }
+    static long tiny_arena_used() {
+        return static_cast<long>(tiny_store->arena_used());
+    }
+
+    // shared by all the threads; sized by the digit_cache_size INI entry
+    static zend::lru_cache<long> digit_cache{0};
+    static long cached_digit_sum(long n) {
+        auto key = std::to_string(n);
+        return *digit_cache.get_or_compute(key, [n]() {
+            long sum = 0;
+            for (long m = n < 0 ? -n : n; m; m /= 10) {
+                sum += m % 10;
+            }
+            return sum;
+        }, sizeof(long));
+    }
+
+    static zend::zstring_view interned_greeting() {
+        return "hello"_zs;
+    }
+
+    // reads $opts['host'] and $opts['port'], with defaults
+    static zend::zval_mixed endpoint_from_options(zend::zval_mixed opts) {
+        zval host, port;
+        ZVAL_INTERNED_STR(&host, "localhost"_zs);
+        ZVAL_LONG(&port, 80);
+        if (Z_TYPE(opts) == IS_ARRAY) {
+            if (zval *h = zend::hash::find(Z_ARRVAL(opts), "host"_cs)) {
+                ZVAL_COPY_DEREF(&host, h);
+            }
+            if (zval *p = zend::hash::find(Z_ARRVAL(opts), "port"_cs)) {
+                ZVAL_COPY_DEREF(&port, p);
+            }
+        }
+        zval result;
+        zend::hash::init_assoc(&result, 2);
+        zend::hash::append(Z_ARRVAL(result), "host"_cs, &host);
+        zend::hash::append(Z_ARRVAL(result), "port"_cs, &port);
+        return zend::zval_mixed{result};
+    }
+
+    static deployment next_port(deployment d) {
+        d.server.port++;
+        return d;
+    }
+
+    static zend::zval_s deployment_json(deployment d) {
+        return zend::json::encode(d);
+    }
+    static zend::zval_s json_string(std::string str) {
+        return zend::json::encode(str);
+    }
+
+    static shape_stats value_shape(zend::zval_mixed value) {
+        shape_visitor visitor;
+        zend::visit(value, visitor);
+        return visitor.stats;
+    }
+
+    // too long to be pooled
+    static const std::string long_label(300, 'x');
+    static zend::pooled_string status_label(long code) {
+        switch (code) {
+        case 200:
+            return "OK";
+        case 404:
+            return "Not Found";
+        case 500:
+            return "Internal Server Error";
+        default:
+            return std::string_view{long_label};
+        }
+    }
+    static long string_pool_size() {
+        return static_cast<long>(zend::string_pool_size());
+    }
+
+    static std::optional<long> positive_or_null(long v) {
+        if (v > 0) {
+            return v;
+        }
+        return std::nullopt;
+    }
+
+    static double celsius_to_fahrenheit(double c) noexcept {
+        return c * 9 / 5 + 32;
+    }
+
+    static long clamp_byte(long v) {
+        return v < 0 ? 0 : v > 255 ? 255 : v;
+    }
+
+    static double scaled(int v, std::optional<double> factor) {
+        return v * factor.value_or(1.0);
+    }
+
+    static bool is_blank(zend::zstring_view str, std::optional<bool> trim) {
+        if (!trim.value_or(true)) {
+            return str.empty();
+        }
+        return str.find_first_not_of(" \t\n") == std::string_view::npos;
+    }
+
+    static long sum_all(zend::variadic<long> values) {
+        long sum = 0;
+        for (long v : values) {
+            sum += v;
+        }
+        return sum;
+    }
+
+    static std::string join_with(zend::zstring_view sep,
+                                 zend::variadic<zend::zstring_view> parts) {
+        std::string res;
+        for (size_t i = 0; i < parts.size(); i++) {
+            if (i > 0) {
+                res += sep;
+            }
+            res += parts[i];
+        }
+        return res;
+    }
+
+    static void buffer_append(zend::string_ref buf, zend::zstring_view chunk) {
+        buf.append(chunk);
+    }
+
+    static long tally(zend::array_ref counts, zend::zstring_view key) {
+        const zval *cur = counts.find(key);
+        long n = cur && Z_TYPE_P(cur) == IS_LONG ? Z_LVAL_P(cur) + 1 : 1;
+        counts.set(key, n);
+        return n;
+    }
+
+    // registered together as describe()
+    static std::string describe(long v) {
+        return "int " + std::to_string(v);
+    }
+    static std::string describe(double v) {
+        return "float " + std::to_string(v);
+    }
+    static std::string describe(zend::zstring_view v) {
+        return "string of length " + std::to_string(v.size());
+    }
+    static std::string describe(long a, long b) {
+        return "pair " + std::to_string(a) + "," + std::to_string(b);
+    }
+    static std::string describe(const WordIndex &) {
+        return "word index";
+    }
+    static std::string describe(const zend::Future &) {
+        return "future";
+    }
+
+    // built at startup
+    static zend::immutable_array country_table;
+    static const zend::immutable_array &countries() {
+        return country_table;
+    }
+
+    static zend::persistent<WordList> word_list{
+            []() { return std::make_unique<WordList>(); },
+            zend::persistent_init::first_use};
+    static WordIndex word_index() {
+        return WordIndex{word_list.get()};
+    }
+    static long word_list_loads() {
+        return WordList::loads;
+    }
+
+    static void spin_until_interrupted() {
+        struct guard {
+            ~guard() { php_printf("native cleanup\n"); }
+        } g;
+        zend::interrupt_poller poll;
+        for (;;) {
+            poll();
+        }
+    }
 }
 
 struct TestGlobals{
@@ -231,9 +577,52 @@ class TestPHPExtension
 
     static const inline auto ini_entries = std::make_tuple(
             zend::BoolINIEntry{"sample_flag", "true", zend::INIPermission::ALL,
-                               [](bool val) { globals().ini_flag = val; }});
+                               [](bool val) { globals().ini_flag = val; }},
+            zend::LongINIEntry{"digit_cache_size", "64K",
+                               zend::INIPermission::SYSTEM,
+                               [](zend_long val) {
+                                   if (val < 0) { // would disable eviction
+                                       return false;
+                                   }
+                                   global_funcs::digit_cache.set_budget(
+                                           static_cast<size_t>(val));
+                                   return true;
+                               }});
+
+    static inline auto snapshots = std::tie(global_funcs::generation);
+    static inline auto persistents = std::tie(global_funcs::word_list);
+
+    // in a static table, before the ones registered below
+    static constexpr auto function_defs = std::tuple{
+            zend::def_function<&global_funcs::next_port>("next_port"),
+            zend::def_function<&global_funcs::deployment_json>(
+                    "deployment_json"),
+            zend::def_function<&global_funcs::json_string>("json_string"),
+            zend::def_function<&global_funcs::value_shape>("value_shape"),
+            zend::def_function<&global_funcs::status_label>("status_label",
+                                                            zend::compact),
+            zend::def_function<&global_funcs::string_pool_size>(
+                    "string_pool_size"),
+            zend::def_function<&global_funcs::positive_or_null>(
+                    "positive_or_null", zend::compact),
+            zend::def_function<&global_funcs::scaled>("scaled", zend::compact),
+            zend::def_function<&global_funcs::is_blank>("is_blank",
+                                                        zend::compact),
+            zend::def_function<&global_funcs::celsius_to_fahrenheit>(
+                    "celsius_to_fahrenheit"),
+            zend::def_function<&global_funcs::clamp_byte>(
+                    "clamp_byte", zend::hot),
+            zend::def_function<&global_funcs::sum_all>("sum_all"),
+            zend::def_function<&global_funcs::join_with>("join_with"),
+            zend::def_function<&global_funcs::buffer_append>("buffer_append"),
+            zend::def_function<&global_funcs::tally>("tally")};
 
     static void register_php_methods() {
+        reg_constant("TESTEXT_API", 20230101);
+        reg_constant("TESTEXT_RATIO", 0.25);
+        reg_constant("TESTEXT_THREADED", zend::zts_build::value);
+        reg_constant("TESTEXT_NAME", "testext"_cs);
+
         reg_function<&global_funcs::print_ini_flag>("print_ini_flag");
         reg_function<&global_funcs::print_global>("print_global");
 
@@ -241,13 +630,75 @@ class TestPHPExtension
         reg_function<&global_funcs::sum_ints_const>("sum_ints_const");
         reg_function<&global_funcs::add_to>("add_to");
         reg_function<&global_funcs::increment_opt>("increment_opt");
+        reg_function<&global_funcs::async_sum_squares>("async_sum_squares");
+        reg_vectorized_function<&global_funcs::scale_score>("scale_scores");
+        reg_vectorized_function<&global_funcs::halve>("halve_all");
+        reg_vectorized_function<&global_funcs::reciprocal>("reciprocals");
+        reg_function<&global_funcs::snapshot_generation>("snapshot_generation");
+        reg_function<&global_funcs::snapshot_repinned_generation>(
+                "snapshot_repinned_generation");
+        reg_function<&global_funcs::counted_square>("memoized_square",
+                                                    zend::memoize);
+        reg_function<&global_funcs::counted_square_calls>("memoized_square_calls");
+        reg_function<&global_funcs::shared_set>("shared_set");
+        reg_function<&global_funcs::shared_get>("shared_get");
+        reg_function<&global_funcs::tiny_set>("tiny_set");
+        reg_function<&global_funcs::tiny_arena_used>("tiny_arena_used");
+        reg_function<&global_funcs::cached_digit_sum>("cached_digit_sum");
+        reg_function<&global_funcs::interned_greeting>("interned_greeting");
+        reg_function<&global_funcs::endpoint_from_options>(
+                "endpoint_from_options");
+        reg_overloads<
+                static_cast<std::string (*)(long)>(&global_funcs::describe),
+                static_cast<std::string (*)(double)>(&global_funcs::describe),
+                static_cast<std::string (*)(zend::zstring_view)>(
+                        &global_funcs::describe),
+                static_cast<std::string (*)(long, long)>(
+                        &global_funcs::describe),
+                static_cast<std::string (*)(const WordIndex &)>(
+                        &global_funcs::describe),
+                static_cast<std::string (*)(const zend::Future &)>(
+                        &global_funcs::describe)>("describe");
+        reg_function<&global_funcs::countries>("countries");
+        reg_function<&global_funcs::word_index>("word_index");
+        reg_function<&global_funcs::word_list_loads>("word_list_loads");
+        reg_function<&global_funcs::spin_until_interrupted>(
+                "spin_until_interrupted");
     }
 
     static int startup(int, int) {
         MyClass::register_class();
+        zend::Future::register_class();
+        WordIndex::register_class();
+        global_funcs::shared_store.emplace(1024, 1024 * 1024);
+        global_funcs::tiny_store.emplace(2, 4096);
+        global_funcs::country_table =
+                zend::immutable_array_builder{}
+                        .add("PT", "Portugal")
+                        .add("FR", "France")
+                        .add("351", true)
+                        .add("eu", zend::immutable_array_builder{}
+                                           .push("PT")
+                                           .push("FR")
+                                           .build())
+                        .build();
         register_classes();
         return SUCCESS;
     }
+
+    static void extension_info() {
+        php_info_print_table_start();
+        global_funcs::digit_cache.print_info_rows("digit sum cache");
+        php_info_print_table_end();
+    }
+
+    static int shutdown(int, int) {
+        zend::worker_pool::instance().shutdown();
+        global_funcs::shared_store.reset();
+        global_funcs::tiny_store.reset();
+        global_funcs::country_table.reset();
+        return SUCCESS;
+    }
 };
 
 namespace global_funcs {
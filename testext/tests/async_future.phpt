@@ -0,0 +1,28 @@
+--TEST--
+Native work submitted to the worker pool and collected through a Future
+--FILE--
+<?php
+$f = async_sum_squares(1000);
+var_dump($f instanceof Phpext\Future);
+$f->wait();
+var_dump($f->isReady());
+var_dump($f->result());
+var_dump($f->result());
+
+$futures = [];
+for ($i = 1; $i <= 4; $i++) {
+    $futures[] = async_sum_squares($i * 10);
+}
+foreach ($futures as $f) {
+    var_dump($f->result());
+}
+?>
+--EXPECT--
+bool(true)
+bool(true)
+int(332833500)
+int(332833500)
+int(285)
+int(2470)
+int(8555)
+int(20540)
@@ -18,6 +18,9 @@ echo "Value of \$x is $x after increment_opt\n";
 try {
     var_dump(sum_ints(2147483648, 3));
 } catch (TypeError $e) { echo $e->getMessage(), "\n"; }
+try {
+    var_dump(sum_ints(3, 2147483648));
+} catch (TypeError $e) { echo $e->getMessage(), "\n"; }
 try {
     var_dump(sum_ints("a", 3));
 } catch (TypeError $e) { echo $e->getMessage(), "\n"; }
@@ -31,6 +34,7 @@ int(4)
 int(4)
 Value of $x is 4 after add_to
 Value of $x is 5 after increment_opt
-sum_ints() has for parameter 0 a int, but the value is not within the accepted bounds
+sum_ints() has for parameter 1 a int, but the value is not within the accepted bounds
+sum_ints() has for parameter 2 a int, but the value is not within the accepted bounds
 Argument 1 passed to sum_ints() must be of the type int, string given
 sum_ints() expects exactly 2 parameters, 1 given
@@ -0,0 +1,36 @@
+--TEST--
+Bindings sharing the compact trampoline
+--FILE--
+<?php
+var_dump(scaled(3), scaled(3, 2.5), scaled(3, null), scaled("4", 2));
+var_dump(is_blank(" \t"), is_blank(" ", false), is_blank("x"));
+var_dump(positive_or_null(5), positive_or_null(-5));
+var_dump(status_label(404));
+try {
+    scaled(2147483648);
+} catch (TypeError $e) { echo $e->getMessage(), "\n"; }
+try {
+    scaled("a");
+} catch (TypeError $e) { echo get_class($e), "\n"; }
+try {
+    is_blank(1);
+} catch (TypeError $e) { echo get_class($e), "\n"; }
+try {
+    scaled();
+} catch (ArgumentCountError $e) { echo $e->getMessage(), "\n"; }
+?>
+--EXPECT--
+float(3)
+float(7.5)
+float(3)
+float(8)
+bool(true)
+bool(false)
+bool(false)
+int(5)
+NULL
+string(9) "Not Found"
+scaled() has for parameter 1 a int, but the value is not within the accepted bounds
+TypeError
+TypeError
+scaled() expects at least 1 parameter, 0 given
@@ -0,0 +1,21 @@
+--TEST--
+Module and class constants
+--FILE--
+<?php
+var_dump(TESTEXT_API, TESTEXT_RATIO, TESTEXT_NAME);
+var_dump(TESTEXT_THREADED === (bool) PHP_ZTS);
+var_dump(WordIndex::DEFAULT_PREFIX, WordIndex::SORTED);
+var_dump(word_index()->countPrefix(WordIndex::DEFAULT_PREFIX));
+
+$c = (new ReflectionExtension('testext'))->getConstants();
+var_dump(array_key_exists('TESTEXT_NAME', $c));
+?>
+--EXPECT--
+int(20230101)
+float(0.25)
+string(7) "testext"
+bool(true)
+string(2) "ap"
+bool(true)
+int(2)
+bool(true)
@@ -0,0 +1,25 @@
+--TEST--
+Array lookups and inserts with compile-time keys
+--FILE--
+<?php
+var_dump(endpoint_from_options([]));
+var_dump(endpoint_from_options(['port' => 8080, 'host' => 'example.org', 'x' => 1]));
+
+$port = 443;
+$opts = ['port' => &$port];
+var_dump(endpoint_from_options($opts)['port']);
+?>
+--EXPECT--
+array(2) {
+  ["host"]=>
+  string(9) "localhost"
+  ["port"]=>
+  int(80)
+}
+array(2) {
+  ["host"]=>
+  string(11) "example.org"
+  ["port"]=>
+  int(8080)
+}
+int(443)
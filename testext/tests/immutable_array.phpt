@@ -0,0 +1,32 @@
+--TEST--
+Immutable arrays built at startup
+--FILE--
+<?php
+$a = countries();
+var_dump($a);
+
+// writes separate the array; the next call sees the original
+$a["PT"] = "changed";
+$a["eu"][] = "DE";
+var_dump(countries()["PT"], count(countries()["eu"]));
+var_dump(countries() === countries());
+?>
+--EXPECT--
+array(4) {
+  ["PT"]=>
+  string(8) "Portugal"
+  ["FR"]=>
+  string(6) "France"
+  [351]=>
+  bool(true)
+  ["eu"]=>
+  array(2) {
+    [0]=>
+    string(2) "PT"
+    [1]=>
+    string(2) "FR"
+  }
+}
+string(8) "Portugal"
+int(2)
+bool(true)
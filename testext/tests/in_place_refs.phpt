@@ -0,0 +1,53 @@
+--TEST--
+Strings and arrays changed in place through references
+--FILE--
+<?php
+buffer_append($buf, "ab");
+for ($i = 0; $i < 100; $i++) {
+    buffer_append($buf, "c");
+}
+var_dump(strlen($buf), substr($buf, 0, 4));
+buffer_append($buf, $buf);
+var_dump(strlen($buf));
+
+$orig = "x";
+$copy = $orig;
+buffer_append($copy, "y");
+var_dump($orig, $copy);
+
+$n = 5;
+try {
+    buffer_append($n, "z");
+} catch (TypeError $e) {
+    echo get_class($e), "\n";
+}
+
+$counts = null;
+tally($counts, "a");
+tally($counts, "b");
+var_dump(tally($counts, "a"));
+$shared = $counts;
+tally($counts, "7");
+var_dump($counts, count($shared));
+
+$param = (new ReflectionFunction('buffer_append'))->getParameters()[0];
+var_dump($param->isPassedByReference());
+?>
+--EXPECT--
+int(102)
+string(4) "abcc"
+int(204)
+string(1) "x"
+string(2) "xy"
+TypeError
+int(2)
+array(3) {
+  ["a"]=>
+  int(2)
+  ["b"]=>
+  int(1)
+  [7]=>
+  int(1)
+}
+int(2)
+bool(true)
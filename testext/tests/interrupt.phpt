@@ -0,0 +1,12 @@
+--TEST--
+Native loops polling for interrupts honour max_execution_time
+--FILE--
+<?php
+set_time_limit(1);
+spin_until_interrupted();
+echo "not reached\n";
+?>
+--EXPECTF--
+native cleanup
+
+Fatal error: Maximum execution time of 1 second exceeded in %s on line %d
@@ -0,0 +1,66 @@
+--TEST--
+JSON encoding of native values
+--FILE--
+<?php
+$flags = JSON_UNESCAPED_SLASHES | JSON_UNESCAPED_UNICODE |
+         JSON_INVALID_UTF8_SUBSTITUTE;
+
+$d = [
+    'name' => 'db',
+    'server' => ['host' => 'localhost', 'port' => 5432, 'timeout' => 1.5],
+];
+echo deployment_json($d), "\n";
+$d['server']['timeout'] = null;
+var_dump(deployment_json($d) === json_encode($d, $flags));
+
+$strings = [
+    '',
+    'plain',
+    "quote \" backslash \\ slash / tab \t nl \n",
+    "control \x01\x1f and del \x7f",
+    'façade, 日本語, 🐘',
+    str_repeat('long ascii run ', 10) . "\"" . str_repeat('x', 20),
+    "bad \xff utf-8",
+    "truncated \xE2\x80X and \xF0\x9F\x90",
+    "\xE2\x28\xA1 \xC0\x80 \xED\xA0\x80 \xF0\x80\x80\x80 \xC3",
+    "line \u{2028} and paragraph \u{2029} separators",
+];
+foreach ($strings as $s) {
+    var_dump(json_string($s) === json_encode($s, $flags));
+}
+echo json_string("a\x00b\xc3"), "\n";
+echo json_string("\xE2\x80X\u{2028}"), "\n";
+
+foreach ([0.0001, 0.00001, 1e15, 1e16, 1e17, 1e25, -2.5e-7, 0.1, -0.0,
+          123.456, 1.7976931348623157e308] as $t) {
+    $d['server']['timeout'] = $t;
+    if (deployment_json($d) !== json_encode($d, $flags)) {
+        echo "mismatch for $t: ", deployment_json($d), "\n";
+    }
+}
+foreach ([INF, NAN] as $t) {
+    $d['server']['timeout'] = $t;
+    try {
+        deployment_json($d);
+    } catch (JsonException $e) {
+        echo $e->getMessage(), " (", $e->getCode(), ")\n";
+    }
+}
+?>
+--EXPECT--
+{"name":"db","server":{"host":"localhost","port":5432,"timeout":1.5}}
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+"a\u0000b�"
+"�X\u2028"
+Inf and NaN cannot be JSON encoded (7)
+Inf and NaN cannot be JSON encoded (7)
@@ -0,0 +1,32 @@
+--TEST--
+Classes whose methods are registered on first use, here by new
+--SKIPIF--
+<?php if (TESTEXT_THREADED) die("skip registered eagerly in ZTS builds"); ?>
+--FILE--
+<?php
+// not registered yet: only reported once something uses the class
+var_dump(method_exists('LazyCounter', 'next'));
+var_dump(get_class_methods('LazyCounter'));
+var_dump(count((new ReflectionClass('LazyCounter'))->getMethods()));
+
+$c = new LazyCounter(5);
+var_dump($c->next(), $c->next());
+var_dump(method_exists('LazyCounter', 'next'));
+var_dump(get_class_methods('LazyCounter'));
+?>
+--EXPECT--
+bool(false)
+array(0) {
+}
+int(0)
+int(6)
+int(7)
+bool(true)
+array(3) {
+  [0]=>
+  string(11) "__construct"
+  [1]=>
+  string(4) "next"
+  [2]=>
+  string(10) "startingAt"
+}
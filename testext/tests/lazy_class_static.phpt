@@ -0,0 +1,15 @@
+--TEST--
+Classes whose methods are registered on first use, here by a static call
+--SKIPIF--
+<?php if (TESTEXT_THREADED) die("skip registered eagerly in ZTS builds"); ?>
+--FILE--
+<?php
+var_dump(method_exists('LazyCounter', 'startingAt'));
+$c = LazyCounter::startingAt(1);
+var_dump($c->next());
+var_dump(count((new ReflectionClass('LazyCounter'))->getMethods()));
+?>
+--EXPECT--
+bool(false)
+int(2)
+int(3)
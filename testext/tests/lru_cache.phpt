@@ -0,0 +1,30 @@
+--TEST--
+Process-wide LRU cache with counters in phpinfo()
+--INI--
+digit_cache_size=64K
+--FILE--
+<?php
+var_dump(cached_digit_sum(1234), cached_digit_sum(1234), cached_digit_sum(-99));
+
+ob_start();
+phpinfo(INFO_MODULES);
+$info = ob_get_clean();
+preg_match_all('/^digit sum cache (\w+) => (\d+)$/m', $info, $m);
+var_dump(array_combine($m[1], $m[2]));
+?>
+--EXPECT--
+int(10)
+int(10)
+int(18)
+array(5) {
+  ["hits"]=>
+  string(1) "1"
+  ["misses"]=>
+  string(1) "2"
+  ["evictions"]=>
+  string(1) "0"
+  ["entries"]=>
+  string(1) "2"
+  ["bytes"]=>
+  string(2) "23"
+}
@@ -0,0 +1,12 @@
+--TEST--
+Process-wide LRU cache: a negative size is rejected for the default
+--INI--
+digit_cache_size=-1
+--FILE--
+<?php
+var_dump(ini_get('digit_cache_size'));
+var_dump(cached_digit_sum(1234));
+?>
+--EXPECT--
+string(3) "64K"
+int(10)
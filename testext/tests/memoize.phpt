@@ -0,0 +1,30 @@
+--TEST--
+Memoized bindings run once per distinct list of arguments
+--FILE--
+<?php
+var_dump(memoized_square(3), memoized_square(3), memoized_square(3));
+var_dump(memoized_square_calls());
+
+// a string is a different key, even if it converts to the same number
+var_dump(memoized_square("3"), memoized_square(4));
+var_dump(memoized_square_calls());
+
+// not the result cached for the weak mode call above
+eval('declare(strict_types=1);
+try {
+    memoized_square("3");
+} catch (TypeError $e) {
+    echo get_class($e), "\n";
+}');
+var_dump(memoized_square_calls());
+?>
+--EXPECT--
+int(9)
+int(9)
+int(9)
+int(1)
+int(9)
+int(16)
+int(3)
+TypeError
+int(3)
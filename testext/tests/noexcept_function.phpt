@@ -0,0 +1,22 @@
+--TEST--
+Bindings of noexcept functions
+--FILE--
+<?php
+const BOILING = 100;
+var_dump(celsius_to_fahrenheit(0));
+var_dump(celsius_to_fahrenheit(BOILING));
+$c = -40;
+var_dump(celsius_to_fahrenheit($c));
+var_dump(celsius_to_fahrenheit("37"));
+try {
+    celsius_to_fahrenheit("hot");
+} catch (TypeError $e) {
+    echo get_class($e), "\n";
+}
+?>
+--EXPECT--
+float(32)
+float(212)
+float(-40)
+float(98.6)
+TypeError
@@ -0,0 +1,39 @@
+--TEST--
+Overload sets dispatched on the argument types
+--FILE--
+<?php
+var_dump(describe(3));
+var_dump(describe(2.5));
+var_dump(describe("abc"));
+var_dump(describe(1, 2));
+var_dump(describe(true)); // no exact match: first overload taking 1 arg
+// class parameters: dispatched on the class of the object
+var_dump(describe(word_index()));
+var_dump(describe(async_sum_squares(3)));
+try {
+    describe(new stdClass);
+} catch (TypeError $e) {
+    echo get_class($e), "\n";
+}
+try {
+    describe([]);
+} catch (TypeError $e) {
+    echo get_class($e), "\n";
+}
+try {
+    describe();
+} catch (ArgumentCountError $e) {
+    echo get_class($e), "\n";
+}
+?>
+--EXPECT--
+string(5) "int 3"
+string(14) "float 2.500000"
+string(18) "string of length 3"
+string(8) "pair 1,2"
+string(5) "int 1"
+string(10) "word index"
+string(6) "future"
+TypeError
+TypeError
+ArgumentCountError
@@ -0,0 +1,21 @@
+--TEST--
+Persistent native objects exposed through proxies
+--FILE--
+<?php
+var_dump(word_list_loads());
+$a = word_index();
+$b = word_index();
+var_dump(get_class($a), $a->countPrefix("ap"), $b->countPrefix("b"));
+var_dump(word_list_loads());
+
+try {
+    (new WordIndex)->countPrefix("a");
+} catch (Exception $e) { echo $e->getMessage(), "\n"; }
+?>
+--EXPECT--
+int(0)
+string(9) "WordIndex"
+int(2)
+int(2)
+int(1)
+Expected the object to have been in the state VALID, but it's in state UNCONSTRUCTED
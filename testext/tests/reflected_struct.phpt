@@ -0,0 +1,59 @@
+--TEST--
+Structs with reflected fields converted from and to arrays
+--FILE--
+<?php
+var_dump(next_port([
+    'name' => 'web',
+    'server' => ['host' => 'example.org', 'port' => '8080', 'extra' => 1],
+]));
+var_dump(next_port([
+    'name' => 'db',
+    'server' => ['host' => 'localhost', 'port' => 5432, 'timeout' => 1.5],
+]));
+
+try {
+    next_port(['name' => 'web', 'server' => ['host' => 'example.org']]);
+} catch (TypeError $e) {
+    echo $e->getMessage(), "\n";
+}
+try {
+    next_port(['name' => 'web', 'server' => ['host' => 'x', 'port' => 'y']]);
+} catch (TypeError $e) {
+    echo $e->getMessage(), "\n";
+}
+try {
+    next_port('web');
+} catch (TypeError $e) {
+    echo get_class($e), "\n";
+}
+?>
+--EXPECT--
+array(2) {
+  ["name"]=>
+  string(3) "web"
+  ["server"]=>
+  array(3) {
+    ["host"]=>
+    string(11) "example.org"
+    ["port"]=>
+    int(8081)
+    ["timeout"]=>
+    NULL
+  }
+}
+array(2) {
+  ["name"]=>
+  string(2) "db"
+  ["server"]=>
+  array(3) {
+    ["host"]=>
+    string(9) "localhost"
+    ["port"]=>
+    int(5433)
+    ["timeout"]=>
+    float(1.5)
+  }
+}
+next_port() expects parameter 1 to be an array with a valid 'port' element
+next_port() expects parameter 1 to be an array with a valid 'port' element
+TypeError
@@ -0,0 +1,34 @@
+--TEST--
+Return types declared in the arginfo of bindings
+--FILE--
+<?php
+function ret($f) {
+    $rf = is_array($f) ? new ReflectionMethod(...$f) : new ReflectionFunction($f);
+    $t = $rf->getReturnType();
+    printf("%s: %s%s\n", is_array($f) ? implode('::', $f) : $f,
+           $t && $t->allowsNull() ? '?' : '', $t ? $t->getName() : '-');
+}
+ret('sum_ints');
+ret('interned_greeting');
+ret('countries');
+ret('print_global');
+ret('word_index');
+ret('positive_or_null');
+ret('shared_get');
+ret('scale_scores');
+ret(['WordIndex', 'countPrefix']);
+
+var_dump(positive_or_null(3), positive_or_null(-3));
+?>
+--EXPECT--
+sum_ints: int
+interned_greeting: string
+countries: array
+print_global: void
+word_index: WordIndex
+positive_or_null: ?int
+shared_get: -
+scale_scores: array
+WordIndex::countPrefix: int
+int(3)
+NULL
@@ -0,0 +1,41 @@
+--TEST--
+Shared memory key/value store
+--FILE--
+<?php
+var_dump(shared_set("name", "phpext"));
+var_dump(shared_set("answer", 42));
+var_dump(shared_set("ratio", 0.5));
+var_dump(shared_set("flag", true));
+var_dump(shared_get("name"), shared_get("answer"), shared_get("ratio"),
+         shared_get("flag"), shared_get("missing"));
+
+// replaced values
+shared_set("answer", "forty-two");
+var_dump(shared_get("answer"));
+
+// arrays and objects are not supported
+var_dump(shared_set("list", [1, 2]));
+
+// strings are usable as array keys and survive the original value
+$s = str_repeat("x", 3);
+shared_set("dyn", $s);
+unset($s);
+$a = [shared_get("dyn") => 1];
+var_dump($a);
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+string(6) "phpext"
+int(42)
+float(0.5)
+bool(true)
+NULL
+string(9) "forty-two"
+bool(false)
+array(1) {
+  ["xxx"]=>
+  int(1)
+}
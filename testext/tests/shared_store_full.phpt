@@ -0,0 +1,20 @@
+--TEST--
+Shared memory store: inserts rejected because the table is full
+--FILE--
+<?php
+var_dump(tiny_set("a", 1), tiny_set("b", 2));
+$used = tiny_arena_used();
+for ($i = 0; $i < 200; $i++) {
+    if (tiny_set("key$i", $i)) {
+        echo "inserted into a full store\n";
+    }
+}
+// no arena space was used by the rejected inserts
+var_dump(tiny_arena_used() === $used);
+var_dump(tiny_set("a", 3));
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
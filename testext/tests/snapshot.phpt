@@ -0,0 +1,19 @@
+--TEST--
+Snapshot values are pinned for the duration of a request
+--FILE--
+<?php
+$first = snapshot_generation();
+var_dump($first >= 1);
+usleep(200000);
+var_dump(snapshot_generation() === $first);
+
+// meanwhile the refresher published newer versions
+$latest = snapshot_repinned_generation();
+var_dump($latest > $first);
+var_dump(snapshot_generation() === $latest);
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
@@ -0,0 +1,47 @@
+--TEST--
+Strings returned from the request string pool
+--FILE--
+<?php
+var_dump(string_pool_size());
+$labels = [];
+foreach ([200, 404, 200, 500, 404, 200] as $code) {
+    $labels[] = status_label($code);
+}
+echo implode(', ', $labels), "\n";
+var_dump(array_count_values($labels));
+
+$labels[0] .= '!';
+var_dump($labels[0], $labels[2], status_label(200));
+
+var_dump(strlen(status_label(1)), status_label(1) === str_repeat('x', 300));
+
+// one entry per distinct pooled value; the long one is not pooled
+var_dump(string_pool_size());
+
+// repeated returns share the pooled string: the pool, $a, $b and the
+// argument of debug_zval_dump() hold it
+unset($labels);
+$a = status_label(404);
+$b = status_label(404);
+debug_zval_dump($a);
+var_dump(string_pool_size());
+?>
+--EXPECT--
+int(0)
+OK, Not Found, OK, Internal Server Error, Not Found, OK
+array(3) {
+  ["OK"]=>
+  int(3)
+  ["Not Found"]=>
+  int(2)
+  ["Internal Server Error"]=>
+  int(1)
+}
+string(3) "OK!"
+string(2) "OK"
+string(2) "OK"
+int(300)
+bool(true)
+int(3)
+string(9) "Not Found" refcount(4)
+int(3)
@@ -0,0 +1,32 @@
+--TEST--
+Variadic parameters read from the call frame
+--FILE--
+<?php
+var_dump(sum_all());
+var_dump(sum_all(1, 2, 3));
+var_dump(sum_all(...[4, 5]));
+var_dump(join_with(", ", "a", "b", "c"));
+var_dump(join_with("-"));
+try {
+    sum_all(1, "x");
+} catch (TypeError $e) {
+    echo get_class($e), "\n";
+}
+try {
+    join_with();
+} catch (ArgumentCountError $e) {
+    echo $e->getMessage(), "\n";
+}
+$param = (new ReflectionFunction('join_with'))->getParameters()[1];
+var_dump($param->isVariadic(), (string) $param->getType());
+?>
+--EXPECT--
+int(0)
+int(6)
+int(9)
+string(7) "a, b, c"
+string(0) ""
+TypeError
+join_with() expects at least 1 parameter, 0 given
+bool(true)
+string(6) "string"
@@ -0,0 +1,33 @@
+--TEST--
+Vectorized bindings over arrays of numbers
+--FILE--
+<?php
+var_dump(scale_scores([]));
+var_dump(scale_scores([1, 2.5, "3", 'k' => 4]));
+
+// large enough to be split across the worker pool
+$r = scale_scores(range(0, 99999));
+var_dump(count($r), $r[0], $r[99999], array_sum($r));
+
+try {
+    scale_scores([1, "x"]);
+} catch (TypeError $e) { echo $e->getMessage(), "\n"; }
+?>
+--EXPECT--
+array(0) {
+}
+array(4) {
+  [0]=>
+  float(3)
+  [1]=>
+  float(6)
+  [2]=>
+  float(7)
+  [3]=>
+  float(9)
+}
+int(100000)
+float(1)
+float(199999)
+float(10000000000)
+scale_scores() expects an array of numbers, but the element at position 1 is of type string
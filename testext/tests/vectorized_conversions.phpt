@@ -0,0 +1,35 @@
+--TEST--
+Vectorized bindings convert the elements as the scalar function would
+--FILE--
+<?php
+var_dump(halve_all([4, "6", 7.0, true]));
+foreach ([NAN, 1e30, 2 ** 40, -(2 ** 40)] as $bad) {
+    try {
+        halve_all([2, $bad]);
+    } catch (TypeError $e) {
+        echo $e->getMessage(), "\n";
+    }
+}
+eval('declare(strict_types=1);
+try {
+    halve_all([2, "6"]);
+} catch (TypeError $e) {
+    echo $e->getMessage(), "\n";
+}');
+?>
+--EXPECT--
+array(4) {
+  [0]=>
+  int(2)
+  [1]=>
+  int(3)
+  [2]=>
+  int(3)
+  [3]=>
+  int(0)
+}
+halve_all() expects an array of numbers, but the element at position 1 is of type float
+halve_all() expects an array of numbers, but the element at position 1 is of type float
+halve_all() expects an array of numbers, but the element at position 1 is not within the accepted bounds
+halve_all() expects an array of numbers, but the element at position 1 is not within the accepted bounds
+halve_all() expects an array of numbers, but the element at position 1 is of type string
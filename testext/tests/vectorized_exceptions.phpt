@@ -0,0 +1,32 @@
+--TEST--
+Vectorized bindings turn C++ exceptions into PHP exceptions
+--FILE--
+<?php
+var_dump(reciprocals([2, 4]));
+try {
+    reciprocals([2, 0, 4]);
+} catch (Exception $e) {
+    echo get_class($e), ": ", $e->getMessage(), "\n";
+}
+
+// thrown on a worker thread
+$values = array_fill(0, 100000, 1.0);
+$values[99999] = 0;
+try {
+    reciprocals($values);
+} catch (Exception $e) {
+    echo get_class($e), ": ", $e->getMessage(), "\n";
+}
+$values[99999] = 1;
+var_dump(count(reciprocals($values)));
+?>
+--EXPECT--
+array(2) {
+  [0]=>
+  float(0.5)
+  [1]=>
+  float(0.25)
+}
+Exception: Native function failed: reciprocal of zero
+Exception: Native function failed: reciprocal of zero
+int(100000)
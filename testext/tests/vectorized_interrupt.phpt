@@ -0,0 +1,12 @@
+--TEST--
+Vectorized bindings honour max_execution_time while converting the input
+--FILE--
+<?php
+$values = range(1, 1000000);
+set_time_limit(1);
+for (;;) {
+    scale_scores($values);
+}
+?>
+--EXPECTF--
+Fatal error: Maximum execution time of 1 second exceeded in %s on line %d
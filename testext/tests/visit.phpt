@@ -0,0 +1,36 @@
+--TEST--
+Iterative walk over nested arrays and objects
+--FILE--
+<?php
+function shape($v) {
+    echo json_encode(value_shape($v)), "\n";
+}
+
+shape(42);
+shape([1, 'two', [3.0, null, [true]], ['k' => 'v']]);
+
+$o = new stdClass;
+$o->list = [1, 2];
+$o->name = 'x';
+shape($o);
+
+$a = [1];
+$a['self'] = &$a;
+shape($a);
+
+$o->self = $o;
+shape($o);
+
+$deep = [];
+for ($i = 0; $i < 20000; $i++) {
+    $deep = [$deep];
+}
+shape($deep);
+?>
+--EXPECT--
+{"scalars":1,"containers":0,"max_depth":0,"recursive":false}
+{"scalars":6,"containers":4,"max_depth":3,"recursive":false}
+{"scalars":3,"containers":2,"max_depth":2,"recursive":false}
+{"scalars":1,"containers":1,"max_depth":1,"recursive":true}
+{"scalars":3,"containers":2,"max_depth":2,"recursive":true}
+{"scalars":0,"containers":20001,"max_depth":20001,"recursive":false}
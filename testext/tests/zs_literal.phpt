@@ -0,0 +1,16 @@
+--TEST--
+Interned _zs literals
+--FILE--
+<?php
+var_dump(interned_greeting());
+$a = [interned_greeting() => 1, "hel" . "lo" => 2];
+var_dump($a);
+var_dump(get_class(async_sum_squares(1)));
+?>
+--EXPECT--
+string(5) "hello"
+array(1) {
+  ["hello"]=>
+  int(2)
+}
+string(13) "Phpext\Future"